@@ -0,0 +1,141 @@
+#include "deco-arena.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace wf
+{
+namespace decor
+{
+static cairo_user_data_key_t lease_key;
+
+surface_arena_t& surface_arena_t::get()
+{
+    static surface_arena_t arena;
+    return arena;
+}
+
+size_t surface_arena_t::get_bucket_bytes(int bucket)
+{
+    return MIN_BUCKET_BYTES << bucket;
+}
+
+cairo_surface_t*surface_arena_t::create(cairo_format_t format, int width, int height)
+{
+    const int stride   = cairo_format_stride_for_width(format, width);
+    const size_t bytes = static_cast<size_t>(stride) * height;
+    int bucket = 0;
+    while ((bucket < BUCKET_COUNT) && (get_bucket_bytes(bucket) < bytes))
+    {
+        bucket++;
+    }
+
+    if ((width <= 0) || (height <= 0) || (stride <= 0) || (bucket >= BUCKET_COUNT))
+    {
+        return cairo_image_surface_create(format, width, height);
+    }
+
+    uint8_t *buffer = nullptr;
+    if (!idle[bucket].empty())
+    {
+        buffer = idle[bucket].back();
+        idle[bucket].pop_back();
+        idle_bytes -= get_bucket_bytes(bucket);
+        schedule_charge();
+    } else
+    {
+        /* Aligned for pixman's vector paths */
+        buffer = static_cast<uint8_t*>(std::aligned_alloc(64, get_bucket_bytes(bucket)));
+        if (!buffer)
+        {
+            return cairo_image_surface_create(format, width, height);
+        }
+    }
+
+    std::memset(buffer, 0, bytes);
+    cairo_surface_t *surface = cairo_image_surface_create_for_data(buffer, format,
+        width, height, stride);
+    auto lease = new lease_t{buffer, bucket};
+    if ((cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) ||
+        (cairo_surface_set_user_data(surface, &lease_key, lease, recycle) !=
+         CAIRO_STATUS_SUCCESS))
+    {
+        cairo_surface_destroy(surface);
+        recycle(lease);
+        return cairo_image_surface_create(format, width, height);
+    }
+
+    return surface;
+}
+
+void surface_arena_t::recycle(void *data)
+{
+    /* Called by cairo_surface_destroy(), possibly while rendering */
+    auto lease  = static_cast<lease_t*>(data);
+    auto& arena = get();
+    arena.idle[lease->bucket].push_back(lease->buffer);
+    arena.idle_bytes += get_bucket_bytes(lease->bucket);
+    arena.schedule_charge();
+    delete lease;
+}
+
+void surface_arena_t::schedule_charge()
+{
+    if (!idle_charge.is_connected())
+    {
+        idle_charge.run_once([=] ()
+        {
+            /* The least recently returned buffers go first */
+            for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+            {
+                while (idle[bucket].size() > MAX_IDLE_PER_BUCKET)
+                {
+                    std::free(idle[bucket].front());
+                    idle[bucket].erase(idle[bucket].begin());
+                    idle_bytes -= get_bucket_bytes(bucket);
+                }
+            }
+
+            charge();
+        });
+    }
+}
+
+void surface_arena_t::charge()
+{
+    if (!entry)
+    {
+        entry = std::make_unique<cache_entry_t>(CACHE_SURFACE_ARENA, [this] ()
+        {
+            clear();
+        });
+    }
+
+    if (idle_bytes > 0)
+    {
+        entry->charge(idle_bytes);
+    } else
+    {
+        entry->release();
+    }
+}
+
+void surface_arena_t::clear()
+{
+    for (auto& bucket : idle)
+    {
+        for (auto buffer : bucket)
+        {
+            std::free(buffer);
+        }
+
+        bucket.clear();
+    }
+
+    idle_bytes = 0;
+    if (entry)
+    {
+        entry->release();
+    }
+}
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "deco-cache.hpp"
+#include <cairo.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * Pixel memory for short-lived cairo image surfaces, e.g. frame parts and
+ * buttons which are drawn, uploaded and destroyed right away.
+ *
+ * Buffers are kept in power-of-two size buckets and handed out again, so
+ * steady redrawing does not allocate and unmap multi-megabyte blocks all
+ * the time. Idle buffers are accounted against the texture budget, after
+ * the frame: surfaces come and go while rendering, where nothing may be
+ * evicted.
+ *
+ * Not thread-safe: surfaces must be created and destroyed on the main thread.
+ */
+class surface_arena_t
+{
+  public:
+    static surface_arena_t& get();
+
+    /**
+     * Create a transparent image surface. Its memory returns to the arena
+     * when the surface is destroyed, so it is used like any other surface.
+     */
+    cairo_surface_t *create(cairo_format_t format, int width, int height);
+
+    /** Free all idle buffers */
+    void clear();
+
+  private:
+    surface_arena_t() = default;
+
+    /** Buckets hold 4 KiB, 8 KiB, ... 64 MiB; larger surfaces bypass the arena */
+    static constexpr size_t MIN_BUCKET_BYTES = 4096;
+    static constexpr int BUCKET_COUNT = 15;
+    /** Upper bound for the idle buffers kept per bucket */
+    static constexpr size_t MAX_IDLE_PER_BUCKET = 4;
+
+    std::vector<uint8_t*> idle[BUCKET_COUNT];
+    size_t idle_bytes = 0;
+    std::unique_ptr<cache_entry_t> entry;
+    wf::wl_idle_call idle_charge;
+
+    /** Attached to each surface, returns its buffer once it is destroyed */
+    struct lease_t
+    {
+        uint8_t *buffer;
+        int bucket;
+    };
+
+    static size_t get_bucket_bytes(int bucket);
+    static void recycle(void *data);
+    /** Trim and charge the idle buffers once the frame is done */
+    void schedule_charge();
+    void charge();
+};
+}
+}
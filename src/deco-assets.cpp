@@ -0,0 +1,602 @@
+#include "deco-assets.hpp"
+#include "deco-trace.hpp"
+#include "deco-worker.hpp"
+#include <wayfire/debug.hpp>
+#include <algorithm>
+#include <cstdint>
+
+#ifdef HAVE_LIBRSVG
+#include "deco-svg.hpp"
+#else
+typedef struct _RsvgHandle RsvgHandle;
+#endif
+
+namespace wf
+{
+namespace decor
+{
+/** Symbolic icons cover this much of the button, like GTK's own */
+static constexpr double ICON_SCALE = 0.85;
+
+static bool is_png(const std::string& path)
+{
+    return (path.size() > 4) && (path.compare(path.size() - 4, 4, ".png") == 0);
+}
+
+/** @return @source at half its size, each pixel the average of a 2x2 block */
+static cairo_surface_t *downsample(cairo_surface_t *source)
+{
+    const int sw = cairo_image_surface_get_width(source);
+    const int sh = cairo_image_surface_get_height(source);
+    const int dw = std::max(sw / 2, 1);
+    const int dh = std::max(sh / 2, 1);
+    cairo_surface_t *result = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, dw, dh);
+
+    cairo_surface_flush(source);
+    const uint8_t *src   = cairo_image_surface_get_data(source);
+    const int src_stride = cairo_image_surface_get_stride(source);
+    uint8_t *dst = cairo_image_surface_get_data(result);
+    const int dst_stride = cairo_image_surface_get_stride(result);
+    for (int y = 0; y < dh; y++)
+    {
+        const uint32_t *row1 = reinterpret_cast<const uint32_t*>(
+            src + std::min(2 * y, sh - 1) * src_stride);
+        const uint32_t *row2 = reinterpret_cast<const uint32_t*>(
+            src + std::min(2 * y + 1, sh - 1) * src_stride);
+        uint32_t *out = reinterpret_cast<uint32_t*>(dst + y * dst_stride);
+        for (int x = 0; x < dw; x++)
+        {
+            const int x1 = std::min(2 * x, sw - 1);
+            const int x2 = std::min(2 * x + 1, sw - 1);
+            uint32_t pixel = 0;
+            /* Premultiplied, so the channels can be averaged independently */
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                const uint32_t sum = ((row1[x1] >> shift) & 0xff) + ((row1[x2] >> shift) & 0xff) +
+                    ((row2[x1] >> shift) & 0xff) + ((row2[x2] >> shift) & 0xff);
+                pixel |= ((sum + 2) / 4) << shift;
+            }
+
+            out[x] = pixel;
+        }
+    }
+
+    cairo_surface_mark_dirty(result);
+    return result;
+}
+
+/** @return The smallest level which is still at least @extent wide and high */
+static cairo_surface_t *pick_level(const std::vector<cairo_surface_t*>& levels, double extent)
+{
+    cairo_surface_t *best = levels.empty() ? nullptr : levels.front();
+    for (auto level : levels)
+    {
+        if ((cairo_image_surface_get_width(level) < extent) ||
+            (cairo_image_surface_get_height(level) < extent))
+        {
+            break;
+        }
+
+        best = level;
+    }
+
+    return best;
+}
+
+/**
+ * Rasterize one image. Touches no shared state, so it may run on any thread,
+ * as long as @handle (the parsed SVG, nullptr for PNGs) is not used by
+ * another thread at the same time.
+ *
+ * @param pyramid The decoded PNG, nullptr for SVGs
+ */
+static cairo_surface_t *rasterize_asset(const asset_request_t& request,
+    RsvgHandle *handle, const std::vector<cairo_surface_t*> *pyramid, std::string& error)
+{
+    const int size = request.size;
+    /* Symbolic icons are only ever used as masks, so only their alpha is kept */
+    const auto format = (request.fit == ASSET_ICON) ? CAIRO_FORMAT_A8 : CAIRO_FORMAT_ARGB32;
+    cairo_surface_t *surface = cairo_image_surface_create(format, size, size);
+    cairo_t *cr = cairo_create(surface);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
+
+    const double inset  = (request.fit == ASSET_ICON) ? size * (1.0 - ICON_SCALE) / 2.0 : 0.0;
+    const double extent = size - 2.0 * inset;
+    bool ok = false;
+
+    if (pyramid)
+    {
+        /* At most a 2x reduction is left for the bilinear filter */
+        if (cairo_surface_t *level = pick_level(*pyramid, extent))
+        {
+            const double sw = cairo_image_surface_get_width(level);
+            const double sh = cairo_image_surface_get_height(level);
+            cairo_translate(cr, inset, inset);
+            cairo_scale(cr, extent / sw, extent / sh);
+            cairo_set_source_surface(cr, level, 0, 0);
+            cairo_paint(cr);
+            ok = true;
+        }
+    }
+#ifdef HAVE_LIBRSVG
+    else if (handle)
+    {
+        /* Full-bleed assets are the whole button, padding is the theme's
+         * business, not ours. */
+        RsvgRectangle viewport = {
+            .x = inset,
+            .y = inset,
+            .width  = extent,
+            .height = extent
+        };
+        GError *gerror = NULL;
+        ok = rsvg_handle_render_document(handle, cr, &viewport, &gerror);
+        if (gerror)
+        {
+            error = gerror->message;
+            g_error_free(gerror);
+        }
+    }
+#else
+    (void)handle;
+    (void)error;
+#endif
+
+    cairo_destroy(cr);
+    if (!ok)
+    {
+        cairo_surface_destroy(surface);
+        return nullptr;
+    }
+
+    return surface;
+}
+
+asset_cache_t& asset_cache_t::get()
+{
+    static asset_cache_t cache;
+    return cache;
+}
+
+std::string asset_cache_t::get_key(const asset_request_t& request)
+{
+    return request.path + "@" + std::to_string(request.size) +
+           ((request.fit == ASSET_ICON) ? "/icon" : "");
+}
+
+bool asset_cache_t::is_mip_level(const asset_request_t& request)
+{
+    return is_png(request.path) && (request.fit == ASSET_FULL_BLEED);
+}
+
+cairo_surface_t*asset_cache_t::get_surface(const asset_request_t& request)
+{
+    if (request.size <= 0)
+    {
+        return nullptr;
+    }
+
+    if (is_mip_level(request))
+    {
+        return pick_level(get_pyramid(request.path), request.size);
+    }
+
+    const std::string key = get_key(request);
+    auto it = assets.find(key);
+    if (it != assets.end())
+    {
+        it->second.last_used = ++serial;
+        if (it->second.entry)
+        {
+            it->second.entry->touch();
+        }
+
+        return it->second.surface;
+    }
+
+    DECO_TRACE_SPAN("rasterize_asset");
+    RsvgHandle *handle = nullptr;
+    const std::vector<cairo_surface_t*> *pyramid = nullptr;
+    if (is_png(request.path))
+    {
+        pyramid = &get_pyramid(request.path);
+    }
+
+#ifdef HAVE_LIBRSVG
+    if (!is_png(request.path))
+    {
+        handle = svg_document_cache_t::get().get_handle(request.path);
+    }
+#endif
+
+    std::string error;
+    cairo_surface_t *surface = rasterize_asset(request, handle, pyramid, error);
+    if (!error.empty())
+    {
+        LOGE("Failed to render ", request.path, ": ", error);
+    }
+
+    // Failures are cached too, so they are not retried every frame
+    insert(request, surface);
+    return surface;
+}
+
+std::shared_ptr<shared_texture_t> asset_cache_t::upload(cairo_surface_t *surface,
+    std::function<void()> evict)
+{
+    return shared_texture_t::create(std::make_shared<wf::owned_texture_t>(surface),
+        static_cast<size_t>(cairo_image_surface_get_width(surface)) *
+        cairo_image_surface_get_height(surface) * 4, CACHE_BUTTON_ASSET, std::move(evict));
+}
+
+std::shared_ptr<wf::owned_texture_t> asset_cache_t::get_texture(const asset_request_t& request,
+    uint64_t owner)
+{
+    cairo_surface_t *surface = get_surface(request);
+    if (!surface)
+    {
+        return nullptr;
+    }
+
+    /* Held in memory and on the GPU, each charged on its own */
+    std::shared_ptr<shared_texture_t> *texture = nullptr;
+    std::function<void()> evict;
+    if (is_mip_level(request))
+    {
+        auto& pyramid = pyramids[request.path];
+        const size_t level = std::find(pyramid.levels.begin(), pyramid.levels.end(), surface) -
+            pyramid.levels.begin();
+        texture = &pyramid.textures[level];
+        evict   = [this, path = request.path, level] ()
+        {
+            auto it = pyramids.find(path);
+            if (it != pyramids.end())
+            {
+                it->second.textures[level].reset();
+            }
+        };
+    } else
+    {
+        texture = &assets[get_key(request)].texture;
+        evict   = [this, key = get_key(request)] ()
+        {
+            auto it = assets.find(key);
+            if (it != assets.end())
+            {
+                it->second.texture.reset();
+            }
+        };
+    }
+
+    if (!*texture)
+    {
+        *texture = upload(surface, std::move(evict));
+    } else
+    {
+        (*texture)->entry.touch();
+    }
+
+    return shared_texture_t::hand_out(*texture, owner);
+}
+
+void asset_cache_t::prerender(const std::vector<asset_request_t>& requests)
+{
+    DECO_TRACE_SPAN("prerender_assets");
+
+    /* One job per file. The job decodes its own copy of the file, since the
+     * cached ones may be used or evicted on this thread meanwhile. */
+    struct job_t
+    {
+        std::string path;
+        std::vector<asset_request_t> requests;
+        std::vector<cairo_surface_t*> surfaces;
+        RsvgHandle *handle = nullptr;
+        std::vector<cairo_surface_t*> pyramid;
+        size_t length = 0;
+        std::string error;
+    };
+
+    std::vector<std::shared_ptr<job_t>> jobs;
+    std::map<std::string, size_t> job_of_path;
+    for (const auto& request : requests)
+    {
+        /* A pyramid serves all sizes of a full-bleed PNG */
+        const bool cached = is_mip_level(request) ? pyramids.count(request.path) :
+            assets.count(get_key(request));
+        const std::string key = is_mip_level(request) ? request.path : get_key(request);
+        if ((request.size <= 0) || cached || !pending.insert(key).second)
+        {
+            continue;
+        }
+
+        auto [it, added] = job_of_path.emplace(request.path, jobs.size());
+        if (added)
+        {
+            jobs.push_back(std::make_shared<job_t>());
+            jobs.back()->path = request.path;
+        }
+
+        jobs[it->second]->requests.push_back(request);
+    }
+
+    for (auto& job : jobs)
+    {
+        render_worker_t::get().submit_background([job] ()
+        {
+            DECO_TRACE_SPAN("prerender_file");
+            const std::vector<cairo_surface_t*> *pyramid = nullptr;
+            if (is_png(job->path))
+            {
+                job->pyramid = build_pyramid(job->path, job->error);
+                pyramid = &job->pyramid;
+            }
+
+#ifdef HAVE_LIBRSVG
+            if (!is_png(job->path))
+            {
+                job->handle = svg_document_cache_t::load(job->path, job->length, job->error);
+            }
+#endif
+
+            for (const auto& request : job->requests)
+            {
+                job->surfaces.push_back(is_mip_level(request) ? nullptr :
+                    rasterize_asset(request, job->handle, pyramid, job->error));
+            }
+        }, [this, job, generation = this->generation] ()
+        {
+            if (!job->error.empty())
+            {
+                LOGE("Failed to render ", job->path, ": ", job->error);
+            }
+
+            /* Dropped by clear() meanwhile, or already rendered on demand */
+            const bool current = (generation == this->generation);
+            if (current && is_png(job->path) && !pyramids.count(job->path))
+            {
+                insert_pyramid(job->path, std::move(job->pyramid));
+                job->pyramid.clear();
+            }
+
+            for (auto level : job->pyramid)
+            {
+                cairo_surface_destroy(level);
+            }
+
+#ifdef HAVE_LIBRSVG
+            auto& documents = svg_document_cache_t::get();
+            if (current && !is_png(job->path) && !documents.contains(job->path))
+            {
+                documents.insert(job->path, job->handle, job->length);
+            } else if (job->handle)
+            {
+                g_object_unref(job->handle);
+            }
+#endif
+
+            for (size_t i = 0; i < job->requests.size(); i++)
+            {
+                const auto& request = job->requests[i];
+                if (is_mip_level(request))
+                {
+                    if (current)
+                    {
+                        pending.erase(request.path);
+                    }
+
+                    continue;
+                }
+
+                const std::string key = get_key(request);
+                if (current && !assets.count(key))
+                {
+                    insert(request, job->surfaces[i]);
+                } else if (job->surfaces[i])
+                {
+                    cairo_surface_destroy(job->surfaces[i]);
+                }
+
+                if (current)
+                {
+                    pending.erase(key);
+                }
+            }
+        });
+    }
+
+    if (!jobs.empty())
+    {
+        LOGD("Pre-rendering ", pending.size(), " button images from ", jobs.size(),
+            " files on the render worker");
+    }
+}
+
+std::vector<cairo_surface_t*> asset_cache_t::build_pyramid(const std::string& path,
+    std::string& error)
+{
+    DECO_TRACE_SPAN("build_pyramid");
+    std::vector<cairo_surface_t*> levels;
+    cairo_surface_t *png = cairo_image_surface_create_from_png(path.c_str());
+    if ((cairo_surface_status(png) != CAIRO_STATUS_SUCCESS) ||
+        (cairo_image_surface_get_width(png) <= 0) || (cairo_image_surface_get_height(png) <= 0))
+    {
+        error = cairo_status_to_string(cairo_surface_status(png));
+        cairo_surface_destroy(png);
+        return levels;
+    }
+
+    levels.push_back(png);
+    while ((levels.size() < MAX_MIP_LEVELS) &&
+           (cairo_image_surface_get_width(levels.back()) > 1) &&
+           (cairo_image_surface_get_height(levels.back()) > 1))
+    {
+        levels.push_back(downsample(levels.back()));
+    }
+
+    return levels;
+}
+
+const std::vector<cairo_surface_t*>& asset_cache_t::get_pyramid(const std::string& path)
+{
+    auto it = pyramids.find(path);
+    if (it != pyramids.end())
+    {
+        if (it->second.entry)
+        {
+            it->second.entry->touch();
+        }
+
+        return it->second.levels;
+    }
+
+    std::string error;
+    auto levels = build_pyramid(path, error);
+    if (!error.empty())
+    {
+        LOGE("Failed to load ", path, ": ", error);
+    }
+
+    insert_pyramid(path, std::move(levels));
+    return pyramids[path].levels;
+}
+
+void asset_cache_t::insert_pyramid(const std::string& path,
+    std::vector<cairo_surface_t*> levels)
+{
+    erase_pyramid(path);
+    auto& pyramid = pyramids[path];
+    pyramid.levels = std::move(levels);
+    pyramid.textures.resize(pyramid.levels.size());
+
+    size_t bytes = 0;
+    for (auto level : pyramid.levels)
+    {
+        bytes += static_cast<size_t>(cairo_image_surface_get_stride(level)) *
+            cairo_image_surface_get_height(level);
+    }
+
+    if (bytes > 0)
+    {
+        pyramid.entry = std::make_unique<cache_entry_t>(CACHE_BUTTON_ASSET, [this, path] ()
+        {
+            erase_pyramid(path);
+        });
+        pyramid.entry->charge(bytes);
+    }
+}
+
+void asset_cache_t::erase_pyramid(const std::string& path)
+{
+    auto it = pyramids.find(path);
+    if (it != pyramids.end())
+    {
+        for (auto& texture : it->second.textures)
+        {
+            if (texture)
+            {
+                texture->uncache();
+            }
+        }
+
+        for (auto level : it->second.levels)
+        {
+            cairo_surface_destroy(level);
+        }
+
+        pyramids.erase(it);
+    }
+}
+
+void asset_cache_t::insert(const asset_request_t& request, cairo_surface_t *surface)
+{
+    const std::string key = get_key(request);
+    erase(key);
+
+    /* Sizes of this file no longer used, e.g. for an unplugged output */
+    std::vector<std::map<std::string, asset_t>::iterator> sizes;
+    for (auto it = assets.begin(); it != assets.end(); ++it)
+    {
+        if ((it->second.path == request.path) && (it->second.fit == request.fit))
+        {
+            sizes.push_back(it);
+        }
+    }
+
+    if (sizes.size() >= MAX_SIZES_PER_FILE)
+    {
+        auto oldest = *std::min_element(sizes.begin(), sizes.end(),
+            [] (const auto& a, const auto& b)
+        {
+            return a->second.last_used < b->second.last_used;
+        });
+        erase(oldest->first);
+    }
+
+    auto& asset = assets[key];
+    asset.path    = request.path;
+    asset.fit     = request.fit;
+    asset.surface = surface;
+    asset.last_used = ++serial;
+    if (surface)
+    {
+        asset.entry = std::make_unique<cache_entry_t>(CACHE_BUTTON_ASSET, [this, key] ()
+        {
+            erase(key);
+        });
+        asset.entry->charge(static_cast<size_t>(cairo_image_surface_get_stride(surface)) *
+            cairo_image_surface_get_height(surface));
+    }
+}
+
+void asset_cache_t::erase(const std::string& key)
+{
+    auto it = assets.find(key);
+    if (it != assets.end())
+    {
+        if (it->second.texture)
+        {
+            it->second.texture->uncache();
+        }
+
+        cairo_surface_destroy(it->second.surface);
+        assets.erase(it);
+    }
+}
+
+void asset_cache_t::clear()
+{
+    /* Pre-rendered images which are still on their way are dropped */
+    generation++;
+    pending.clear();
+    for (auto& [key, asset] : assets)
+    {
+        if (asset.texture)
+        {
+            asset.texture->uncache();
+        }
+
+        cairo_surface_destroy(asset.surface);
+    }
+
+    assets.clear();
+
+    for (auto& [path, pyramid] : pyramids)
+    {
+        for (auto& texture : pyramid.textures)
+        {
+            if (texture)
+            {
+                texture->uncache();
+            }
+        }
+
+        for (auto level : pyramid.levels)
+        {
+            cairo_surface_destroy(level);
+        }
+    }
+
+    pyramids.clear();
+}
+}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "deco-cache.hpp"
+#include <cairo.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/** How an image file is placed on its square surface */
+enum asset_fit_t
+{
+    /** The image is the whole button, e.g. metacity-1 titlebuttons */
+    ASSET_FULL_BLEED = 0,
+    /** A symbolic icon, inset so it sits inside the drawn button circle.
+     * Rasterized as an A8 mask, to be painted in the icon color. */
+    ASSET_ICON       = 1,
+};
+
+/** An image file rasterized at a given size */
+struct asset_request_t
+{
+    std::string path;
+    int size;
+    asset_fit_t fit;
+};
+
+/**
+ * Button images rasterized from theme files (PNG or SVG), shared by all
+ * decorations and accounted against the texture budget.
+ *
+ * Images are rendered on first use, or ahead of time with prerender() when a
+ * theme is loaded, so the first hover of a button does not stall a frame.
+ * PNGs are decoded once into a small mip pyramid, and full-bleed buttons are
+ * served straight from the smallest level covering the requested size, to be
+ * scaled when drawn: less than halving, so it cannot alias. SVGs and icon
+ * masks are rasterized per size, keeping the last few sizes of each file.
+ */
+class asset_cache_t
+{
+  public:
+    static asset_cache_t& get();
+
+    /**
+     * @return The rasterized image, or nullptr if the file cannot be
+     *   rendered. The surface is owned by the cache and stays valid until the
+     *   next lookup or clear(). A full-bleed PNG may be up to twice as large
+     *   as requested.
+     */
+    cairo_surface_t *get_surface(const asset_request_t& request);
+
+    /**
+     * @return The rasterized image uploaded as a texture, or nullptr if the
+     *   file cannot be rendered. Only for ASSET_FULL_BLEED images. The texture is created on first use and
+     *   shared by everyone drawing the same image; it stays charged until
+     *   the last of them drops it, see shared_texture_t.
+     * @param owner The decoration the texture is handed out to, 0 if none
+     */
+    std::shared_ptr<wf::owned_texture_t> get_texture(const asset_request_t& request,
+        uint64_t owner = 0);
+
+    /**
+     * Rasterize all requests which are not cached yet on the render worker,
+     * behind any title waiting there, and add the results from the main
+     * thread as each file is done. Returns right away.
+     */
+    void prerender(const std::vector<asset_request_t>& requests);
+
+    /** Drop all images, e.g. because the theme changed */
+    void clear();
+
+  private:
+    asset_cache_t() = default;
+
+    /** Levels kept per PNG, including the full-size image */
+    static constexpr int MAX_MIP_LEVELS = 6;
+    /** Sizes kept per file and fit, e.g. one per output scale */
+    static constexpr size_t MAX_SIZES_PER_FILE = 4;
+
+    /** A decoded PNG and its successive halvings, largest first */
+    struct pyramid_t
+    {
+        /** Empty for files which failed to decode */
+        std::vector<cairo_surface_t*> levels;
+        /** The levels uploaded on first use by get_texture(), charged on their own */
+        std::vector<std::shared_ptr<shared_texture_t>> textures;
+        std::unique_ptr<cache_entry_t> entry;
+    };
+
+    /** Keyed by path */
+    std::map<std::string, pyramid_t> pyramids;
+
+    struct asset_t
+    {
+        std::string path;
+        asset_fit_t fit;
+        /** nullptr for files which failed to render */
+        cairo_surface_t *surface = nullptr;
+        /** Uploaded on first use by get_texture(), charged on its own */
+        std::shared_ptr<shared_texture_t> texture;
+        std::unique_ptr<cache_entry_t> entry;
+        /** asset_cache_t::serial when last looked up */
+        uint64_t last_used = 0;
+    };
+
+    /** Rasterized SVGs and icon masks, keyed by "<path>@<size>" with a
+     * suffix for the fit */
+    std::map<std::string, asset_t> assets;
+    /** Counts lookups, to find the least recently used size of a file */
+    uint64_t serial = 0;
+    /** Keys being pre-rendered, so they are not queued twice */
+    std::set<std::string> pending;
+    /** Incremented by clear(), so stale pre-rendered images are dropped */
+    uint64_t generation = 0;
+
+    static std::string get_key(const asset_request_t& request);
+    /** @return Whether @request is served from a pyramid level as it is */
+    static bool is_mip_level(const asset_request_t& request);
+
+    /** Decode a PNG and build its pyramid. Safe to call from any thread. */
+    static std::vector<cairo_surface_t*> build_pyramid(const std::string& path,
+        std::string& error);
+    /** @return The pyramid of a PNG, decoded if necessary */
+    const std::vector<cairo_surface_t*>& get_pyramid(const std::string& path);
+    /** Add a decoded pyramid, taking ownership of its levels */
+    void insert_pyramid(const std::string& path, std::vector<cairo_surface_t*> levels);
+    void erase_pyramid(const std::string& path);
+
+    /** @return A texture for @surface, which @evict drops from the cache */
+    static std::shared_ptr<shared_texture_t> upload(cairo_surface_t *surface,
+        std::function<void()> evict);
+
+    /**
+     * Add a rendered image, taking ownership of @surface (may be nullptr),
+     * and drop the least recently used size of the file if it has too many.
+     */
+    void insert(const asset_request_t& request, cairo_surface_t *surface);
+    void erase(const std::string& key);
+};
+}
+}
@@ -1,5 +1,6 @@
 #include "deco-button.hpp"
 #include "deco-theme.hpp"
+#include "deco-textures.hpp"
 #include <wayfire/opengl.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
 
@@ -12,8 +13,16 @@ namespace wf
 namespace decor
 {
 button_t::button_t(const decoration_theme_t& t, std::function<void()> damage) :
-    theme(t), damage_callback(damage)
-{}
+    theme(t),
+    cache_entry(CACHE_BUTTON, [=] ()
+    {
+        this->button_texture = nullptr;
+        this->texture_valid  = false;
+    }),
+    damage_callback(damage)
+{
+    cache_entry.set_owner(theme.get_owner());
+}
 
 void button_t::set_button_type(button_type_t type)
 {
@@ -74,29 +83,83 @@ void button_t::set_activated(bool activated)
 
 void button_t::render(const scene::render_instruction_t& data, wf::geometry_t geometry)
 {
-    data.pass->add_texture(button_texture.get_texture(), data.target, geometry, data.damage);
+    if (data.target.scale != scale)
+    {
+        scale = data.target.scale;
+        texture_valid = false;
+    }
+
+    if (!texture_valid)
+    {
+        update_texture();
+    }
+
+    cache_entry.touch();
+    data.pass->add_texture(button_texture->get_texture(), data.target, geometry, data.damage);
     if (this->hover.running())
     {
         add_idle_damage();
     }
 }
 
-void button_t::update_texture()
+bool button_t::is_at_rest()
+{
+    return !is_hovered && !is_pressed && !hover.running() && ((double)hover == NORMAL);
+}
+
+/**
+ * Render at 2x resolution, or the output scale if higher, for crisp display
+ * This prevents blurriness when rendered on screen
+ */
+static decoration_theme_t::button_state_t get_button_state(const decoration_theme_t& theme,
+    double hover_progress, bool activated, double scale)
 {
-    /**
-     * Render at 2x resolution for crisp display
-     * This prevents blurriness when rendered on screen
-     */
-    decoration_theme_t::button_state_t state = {
-        .width  = 2.0 * 0.64 * theme.get_title_height(),
-        .height = 2.0 * 0.64 * theme.get_title_height(),
+    return decoration_theme_t::button_state_t{
+        .width  = theme.get_button_size(scale),
+        .height = theme.get_button_size(scale),
         .border = 2.0,
-        .hover_progress = hover,
-        .activated = is_activated,
+        .hover_progress = hover_progress,
+        .activated = activated,
     };
+}
+
+void button_t::paint_at_rest(cairo_t *cr, wf::geometry_t geometry, double scale) const
+{
+    auto state   = get_button_state(theme, NORMAL, is_activated, scale);
+    auto surface = theme.get_button_surface(type, state);
+
+    cairo_save(cr);
+    cairo_translate(cr, geometry.x, geometry.y);
+    /* Pixmaps come at their nearest mip level, not necessarily the state's size */
+    cairo_scale(cr, geometry.width / cairo_image_surface_get_width(surface),
+        geometry.height / cairo_image_surface_get_height(surface));
+    cairo_set_source_surface(cr, surface, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+    cairo_restore(cr);
+
+    cairo_surface_destroy(surface);
+}
+
+void button_t::update_texture()
+{
+    auto state = get_button_state(theme, hover, is_activated, scale);
+    if (auto pixmap = theme.get_button_texture(type, state))
+    {
+        /* Already uploaded and accounted for by the asset cache */
+        this->button_texture = pixmap;
+        this->texture_valid  = true;
+        cache_entry.release();
+        return;
+    }
 
+    /* Hover animations redraw the same size every frame, so the texture is
+     * updated in place rather than reallocated */
     auto surface = theme.get_button_surface(type, state);
-    this->button_texture = owned_texture_t{surface};
+    texture_pool_t::get().upload(this->button_texture, surface);
+    this->texture_valid  = true;
+    cache_entry.charge(static_cast<size_t>(cairo_image_surface_get_width(surface)) *
+        cairo_image_surface_get_height(surface) * 4);
     cairo_surface_destroy(surface);
 }
 
@@ -7,6 +7,8 @@
 #include <wayfire/util/duration.hpp>
 #include <wayfire/plugins/common/cairo-util.hpp>
 
+#include "deco-cache.hpp"
+
 #include <cairo.h>
 #include <pango/pango.h>
 #include <pango/pangocairo.h>
@@ -78,12 +80,34 @@ class button_t
      */
     void render(const scene::render_instruction_t& data, wf::geometry_t geometry);
 
+    /**
+     * @return Whether the button is neither hovered, pressed nor animating,
+     *  i.e. it looks exactly like paint_at_rest() draws it.
+     */
+    bool is_at_rest();
+
+    /**
+     * Paint the button in its resting state with @cr, scaled to fill
+     * @geometry. Lets the decoration batch all resting buttons into one
+     * texture.
+     *
+     * @param scale The scale of the output the button is shown on
+     */
+    void paint_at_rest(cairo_t *cr, wf::geometry_t geometry, double scale) const;
+
   private:
     const decoration_theme_t& theme;
 
     /* Whether the button needs repaint */
     button_type_t type;
-    wf::owned_texture_t button_texture;
+    /* Either owned by this button, or a theme pixmap shared by all buttons */
+    std::shared_ptr<wf::owned_texture_t> button_texture;
+    /* Whether button_texture holds a rendered image (false after eviction) */
+    bool texture_valid = false;
+    /* The scale of the output the button was last rendered on */
+    double scale = 1.0;
+    /* Accounts button_texture against the texture budget, unless shared */
+    cache_entry_t cache_entry;
 
     /* Whether the button is currently being hovered */
     bool is_hovered = false;
@@ -0,0 +1,489 @@
+#include "deco-cache.hpp"
+#include <wayfire/debug.hpp>
+#include <algorithm>
+
+namespace wf
+{
+namespace decor
+{
+texture_budget_t& texture_budget_t::get()
+{
+    static texture_budget_t budget;
+    return budget;
+}
+
+texture_budget_t::texture_budget_t()
+{
+    budget_mb.set_callback([=] ()
+    {
+        schedule_enforce();
+    });
+}
+
+void texture_budget_t::schedule_enforce()
+{
+    if (!idle_enforce.is_connected())
+    {
+        idle_enforce.run_once([=] ()
+        {
+            enforce();
+        });
+    }
+}
+
+size_t texture_budget_t::get_usage() const
+{
+    return usage;
+}
+
+size_t texture_budget_t::get_usage(cache_category_t category) const
+{
+    return category_usage[category];
+}
+
+size_t texture_budget_t::get_budget() const
+{
+    const int mb = budget_mb;
+    return (mb > 0) ? static_cast<size_t>(mb) * 1024 * 1024 : 0;
+}
+
+size_t texture_budget_t::get_entry_count() const
+{
+    return lru.size();
+}
+
+size_t texture_budget_t::get_eviction_count() const
+{
+    return evictions;
+}
+
+size_t texture_budget_t::get_owner_usage(uint64_t owner) const
+{
+    auto it = owners.find(owner);
+    return (it != owners.end()) ? it->second.bytes : 0;
+}
+
+size_t texture_budget_t::get_owner_usage(uint64_t owner, cache_category_t category) const
+{
+    auto it = owners.find(owner);
+    return (it != owners.end()) ? it->second.categories[category] : 0;
+}
+
+size_t texture_budget_t::get_owner_held(uint64_t owner) const
+{
+    auto it = held.find(owner);
+    return (it != held.end()) ? it->second : 0;
+}
+
+bool texture_budget_t::check_owner_released(uint64_t owner) const
+{
+    const size_t charged = get_owner_usage(owner);
+    const size_t handed_out = get_owner_held(owner);
+    if ((charged == 0) && (handed_out == 0))
+    {
+        return true;
+    }
+
+    LOGE("Decoration ", owner, " destroyed with ", charged, " bytes of cached textures "
+        "still charged to it and ", handed_out, " bytes of shared textures still held");
+    for (int i = 0; i < CACHE_CATEGORY_COUNT; i++)
+    {
+        auto category = cache_category_t(i);
+        if (size_t bytes = get_owner_usage(owner, category))
+        {
+            LOGE("  ", get_category_name(category), ": ", bytes, " bytes");
+        }
+    }
+
+    return false;
+}
+
+std::vector<uint64_t> texture_budget_t::get_owners() const
+{
+    std::vector<uint64_t> ids;
+    for (const auto& [id, usage] : owners)
+    {
+        ids.push_back(id);
+    }
+
+    for (const auto& [id, bytes] : held)
+    {
+        if (!owners.count(id))
+        {
+            ids.push_back(id);
+        }
+    }
+
+    return ids;
+}
+
+std::vector<const cache_entry_t*> texture_budget_t::get_largest_entries(size_t count) const
+{
+    std::vector<const cache_entry_t*> entries(lru.begin(), lru.end());
+    count = std::min(count, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+        [] (const cache_entry_t *a, const cache_entry_t *b)
+    {
+        return a->bytes > b->bytes;
+    });
+    entries.resize(count);
+    return entries;
+}
+
+const char*texture_budget_t::get_category_name(cache_category_t category)
+{
+    static const char *names[CACHE_CATEGORY_COUNT] = {
+        "background",
+        "title",
+        "button",
+        "button-asset",
+        "svg-document",
+        "glyph-atlas",
+        "texture-pool",
+        "surface-arena",
+    };
+
+    return names[category];
+}
+
+void texture_budget_t::account(const cache_entry_t *entry, bool add)
+{
+    auto& owner = owners[entry->owner];
+    if (add)
+    {
+        usage += entry->bytes;
+        category_usage[entry->category] += entry->bytes;
+        owner.bytes += entry->bytes;
+        owner.categories[entry->category] += entry->bytes;
+        owner.entries++;
+        return;
+    }
+
+    usage -= entry->bytes;
+    category_usage[entry->category] -= entry->bytes;
+    owner.bytes -= entry->bytes;
+    owner.categories[entry->category] -= entry->bytes;
+    if (--owner.entries == 0)
+    {
+        owners.erase(entry->owner);
+    }
+}
+
+void texture_budget_t::account_held(uint64_t owner, size_t bytes, bool add)
+{
+    if (add)
+    {
+        held[owner] += bytes;
+        return;
+    }
+
+    auto it = held.find(owner);
+    if (it == held.end())
+    {
+        return;
+    }
+
+    it->second -= std::min(bytes, it->second);
+    if (it->second == 0)
+    {
+        held.erase(it);
+    }
+}
+
+void texture_budget_t::enforce()
+{
+    /* Entries used from now on belong to the next frame */
+    const uint64_t current_frame = frame_serial++;
+    const size_t budget = get_budget();
+    if ((budget == 0) || (usage <= budget))
+    {
+        over_budget_reported = false;
+        return;
+    }
+
+    if (!over_budget_reported)
+    {
+        LOGI("Decoration caches hold ", usage / 1024, " KiB, over the budget of ",
+            budget / 1024, " KiB; evicting least recently used entries");
+        over_budget_reported = true;
+    }
+
+    auto it = lru.end();
+    while ((usage > budget) && (it != lru.begin()))
+    {
+        --it;
+        cache_entry_t *victim = *it;
+        if (victim->last_used == current_frame)
+        {
+            /* Everything from here on was used by the last frame: evicting
+             * it would only redraw it in the next one */
+            LOGD("Decoration textures of the last frame alone exceed the budget");
+            break;
+        }
+
+        if (victim->in_use && victim->in_use())
+        {
+            continue;
+        }
+
+        /* Unlink first: the callback may destroy the entry, and it must not
+         * find itself in the list while doing so. */
+        it = lru.erase(it);
+        account(victim, false);
+        victim->bytes  = 0;
+        victim->linked = false;
+        ++evictions;
+
+        auto callback = victim->evict;
+        callback();
+    }
+
+    LOGD("Decoration caches now hold ", usage / 1024, " KiB in ", lru.size(), " entries");
+}
+
+cache_entry_t::cache_entry_t(cache_category_t category, std::function<void()> evict) :
+    category(category), evict(std::move(evict))
+{}
+
+cache_entry_t::~cache_entry_t()
+{
+    release();
+}
+
+void cache_entry_t::charge(size_t new_bytes)
+{
+    auto& budget = texture_budget_t::get();
+    if (linked)
+    {
+        budget.account(this, false);
+        budget.lru.splice(budget.lru.begin(), budget.lru, position);
+    } else
+    {
+        budget.lru.push_front(this);
+        position = budget.lru.begin();
+        linked   = true;
+    }
+
+    bytes     = new_bytes;
+    last_used = budget.frame_serial;
+    budget.account(this, true);
+    budget.schedule_enforce();
+}
+
+void cache_entry_t::release()
+{
+    if (!linked)
+    {
+        return;
+    }
+
+    auto& budget = texture_budget_t::get();
+    budget.account(this, false);
+    budget.lru.erase(position);
+    bytes  = 0;
+    linked = false;
+}
+
+void cache_entry_t::touch()
+{
+    if (linked)
+    {
+        auto& budget = texture_budget_t::get();
+        budget.lru.splice(budget.lru.begin(), budget.lru, position);
+        last_used = budget.frame_serial;
+    }
+}
+
+size_t cache_entry_t::get_size() const
+{
+    return bytes;
+}
+
+void cache_entry_t::set_owner(uint64_t new_owner)
+{
+    if (!linked)
+    {
+        owner = new_owner;
+        return;
+    }
+
+    auto& budget = texture_budget_t::get();
+    budget.account(this, false);
+    owner = new_owner;
+    budget.account(this, true);
+}
+
+uint64_t cache_entry_t::get_owner() const
+{
+    return owner;
+}
+
+cache_category_t cache_entry_t::get_category() const
+{
+    return category;
+}
+
+void cache_entry_t::set_in_use(std::function<bool()> in_use)
+{
+    this->in_use = std::move(in_use);
+}
+
+shared_texture_t::shared_texture_t(std::shared_ptr<wf::owned_texture_t> texture,
+    cache_category_t category, std::function<void()> evict) :
+    texture(std::move(texture)), entry(category, std::move(evict))
+{}
+
+std::shared_ptr<shared_texture_t> shared_texture_t::create(
+    std::shared_ptr<wf::owned_texture_t> texture, size_t bytes,
+    cache_category_t category, std::function<void()> evict)
+{
+    auto shared = std::make_shared<shared_texture_t>(std::move(texture), category,
+        std::move(evict));
+    /* The cache holds one reference, every decoration showing it another */
+    std::weak_ptr<shared_texture_t> weak = shared;
+    shared->entry.set_in_use([weak] ()
+    {
+        return weak.use_count() > 1;
+    });
+    shared->entry.charge(bytes);
+    return shared;
+}
+
+std::shared_ptr<wf::owned_texture_t> shared_texture_t::hand_out(
+    const std::shared_ptr<shared_texture_t>& shared, uint64_t owner)
+{
+    if (owner == 0)
+    {
+        return std::shared_ptr<wf::owned_texture_t>(shared, shared->texture.get());
+    }
+
+    /** Counts the texture as held by @owner for as long as it is referenced */
+    struct hold_t
+    {
+        hold_t(std::shared_ptr<shared_texture_t> shared, uint64_t owner) :
+            shared(std::move(shared)), owner(owner), bytes(this->shared->entry.get_size())
+        {
+            texture_budget_t::get().account_held(owner, bytes, true);
+        }
+
+        ~hold_t()
+        {
+            texture_budget_t::get().account_held(owner, bytes, false);
+        }
+
+        std::shared_ptr<shared_texture_t> shared;
+        uint64_t owner;
+        size_t bytes;
+    };
+
+    auto hold = std::make_shared<hold_t>(shared, owner);
+    return std::shared_ptr<wf::owned_texture_t>(hold, shared->texture.get());
+}
+
+void shared_texture_t::uncache()
+{
+    entry.set_in_use([] ()
+    {
+        return true;
+    });
+}
+
+title_cache_t& title_cache_t::get()
+{
+    static title_cache_t cache;
+    return cache;
+}
+
+std::shared_ptr<wf::owned_texture_t> title_cache_t::find(const std::string& key,
+    uint64_t owner)
+{
+    auto it = index.find(key);
+    if (it == index.end())
+    {
+        return nullptr;
+    }
+
+    titles.splice(titles.begin(), titles, it->second);
+    it->second->shared->entry.touch();
+    return shared_texture_t::hand_out(it->second->shared, owner);
+}
+
+std::shared_ptr<wf::owned_texture_t> title_cache_t::insert(const std::string& key,
+    std::shared_ptr<wf::owned_texture_t> tex, size_t bytes, uint64_t owner)
+{
+    erase(key);
+    for (auto it = titles.end(); (titles.size() >= MAX_TITLES) && (it != titles.begin());)
+    {
+        --it;
+        if (it->shared.use_count() == 1)
+        {
+            index.erase(it->key);
+            it = titles.erase(it);
+        }
+    }
+
+    auto shared = shared_texture_t::create(std::move(tex), bytes, CACHE_TITLE, [this, key] ()
+    {
+        erase(key);
+    });
+    titles.push_front(title_t{key, shared});
+    index[key] = titles.begin();
+    return shared_texture_t::hand_out(shared, owner);
+}
+
+void title_cache_t::erase(const std::string& key)
+{
+    auto it = index.find(key);
+    if (it != index.end())
+    {
+        it->second->shared->uncache();
+        titles.erase(it->second);
+        index.erase(it);
+    }
+}
+
+void title_cache_t::clear()
+{
+    for (auto& title : titles)
+    {
+        title.shared->uncache();
+    }
+
+    index.clear();
+    titles.clear();
+}
+
+size_t title_cache_t::size() const
+{
+    return titles.size();
+}
+
+path_lookup_cache_t& path_lookup_cache_t::get()
+{
+    static path_lookup_cache_t cache;
+    return cache;
+}
+
+bool path_lookup_cache_t::find(const std::string& key, std::string& path) const
+{
+    auto it = paths.find(key);
+    if (it == paths.end())
+    {
+        return false;
+    }
+
+    path = it->second;
+    return true;
+}
+
+void path_lookup_cache_t::insert(const std::string& key, const std::string& path)
+{
+    paths[key] = path;
+}
+
+void path_lookup_cache_t::clear()
+{
+    paths.clear();
+}
+}
+}
@@ -0,0 +1,291 @@
+#pragma once
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/util.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/** The kinds of resources the decorations keep cached between frames */
+enum cache_category_t
+{
+    CACHE_BACKGROUND        = 0,
+    CACHE_TITLE             = 1,
+    CACHE_BUTTON            = 2,
+    CACHE_BUTTON_ASSET      = 3,
+    CACHE_SVG_DOCUMENT      = 4,
+    CACHE_GLYPH_ATLAS       = 5,
+    CACHE_TEXTURE_POOL      = 6,
+    CACHE_SURFACE_ARENA     = 7,
+    CACHE_CATEGORY_COUNT    = 8,
+};
+
+class cache_entry_t;
+
+/**
+ * A process-wide memory budget shared by all decoration caches.
+ *
+ * Every cached texture or surface is represented by a cache_entry_t which
+ * charges its size against the budget. When the total goes over
+ * gtkdecor/texture_budget, the least recently used entries are asked to free
+ * their resource; their owner regenerates it the next time it is drawn.
+ *
+ * The budget is enforced once the current frame is done, never in the middle
+ * of one: textures already submitted to the render pass must stay alive, and
+ * entries used by the last frame are only evicted by a lower budget.
+ */
+class texture_budget_t
+{
+  public:
+    static texture_budget_t& get();
+
+    /** @return Total bytes currently held by all decoration caches */
+    size_t get_usage() const;
+    /** @return Bytes currently held by caches of the given category */
+    size_t get_usage(cache_category_t category) const;
+    /** @return The configured budget in bytes, or 0 if unlimited */
+    size_t get_budget() const;
+    /** @return Number of live cache entries */
+    size_t get_entry_count() const;
+    /** @return Number of entries evicted since startup */
+    size_t get_eviction_count() const;
+
+    /** @return Bytes held for the given owner, 0 for shared resources */
+    size_t get_owner_usage(uint64_t owner) const;
+    /** @return Bytes held for the given owner by caches of the given category */
+    size_t get_owner_usage(uint64_t owner, cache_category_t category) const;
+    /**
+     * @return Bytes of shared textures handed out to the given owner which
+     *   are still referenced, see shared_texture_t::hand_out()
+     */
+    size_t get_owner_held(uint64_t owner) const;
+    /**
+     * Called once the owner is gone: logs everything still charged to it or
+     * handed out to it as an error.
+     *
+     * @return Whether nothing is left, i.e. the owner leaked nothing
+     */
+    bool check_owner_released(uint64_t owner) const;
+    /** @return All owners holding cached resources or shared textures, 0 for
+     *   shared resources */
+    std::vector<uint64_t> get_owners() const;
+    /** @return The @count largest live entries, largest first */
+    std::vector<const cache_entry_t*> get_largest_entries(size_t count) const;
+
+    /** @return The name of a category, as shown by gtkdecor/memory */
+    static const char *get_category_name(cache_category_t category);
+
+  private:
+    texture_budget_t();
+    friend class cache_entry_t;
+
+    /* Most recently used first */
+    std::list<cache_entry_t*> lru;
+    size_t usage = 0;
+    size_t category_usage[CACHE_CATEGORY_COUNT] = {};
+    size_t evictions = 0;
+    bool over_budget_reported = false;
+    /** Counts enforce() runs, i.e. frames in which the caches were used */
+    uint64_t frame_serial = 1;
+    wf::wl_idle_call idle_enforce;
+
+    /** Live totals of one view's entries */
+    struct owner_usage_t
+    {
+        size_t bytes   = 0;
+        size_t entries = 0;
+        size_t categories[CACHE_CATEGORY_COUNT] = {};
+    };
+
+    std::unordered_map<uint64_t, owner_usage_t> owners;
+    /** Bytes of shared textures referenced through each owner's hand-outs */
+    std::unordered_map<uint64_t, size_t> held;
+
+    wf::option_wrapper_t<int> budget_mb{"gtkdecor/texture_budget"};
+
+    /** Evict least recently used entries until within budget */
+    void enforce();
+    /** Run enforce() once the current frame is done */
+    void schedule_enforce();
+    /** Add the bytes of @entry to the totals, or subtract them */
+    void account(const cache_entry_t *entry, bool add);
+    /** Add @bytes handed out to @owner, or subtract them */
+    void account_held(uint64_t owner, size_t bytes, bool add);
+    friend struct shared_texture_t;
+};
+
+/**
+ * A single cached resource accounted against the texture budget.
+ *
+ * The owner calls charge() whenever it (re)creates the resource and touch()
+ * whenever it is used. On eviction the callback passed at construction must
+ * free the resource; it may destroy the entry itself.
+ *
+ * Entries belonging to a single decoration are tagged with its owner token,
+ * so memory can be attributed to views; all others are shared.
+ */
+class cache_entry_t
+{
+  public:
+    cache_entry_t(cache_category_t category, std::function<void()> evict);
+    ~cache_entry_t();
+    cache_entry_t(const cache_entry_t&) = delete;
+    cache_entry_t(cache_entry_t&&) = delete;
+    cache_entry_t& operator =(const cache_entry_t&) = delete;
+    cache_entry_t& operator =(cache_entry_t&&) = delete;
+
+    /** The resource now holds @bytes. Other entries may be evicted after the frame. */
+    void charge(size_t bytes);
+    /** The resource was freed by its owner */
+    void release();
+    /** Mark the resource as recently used */
+    void touch();
+    /** @return The bytes currently charged for this entry */
+    size_t get_size() const;
+
+    /** Attribute the resource to a decoration's owner token, 0 if shared */
+    void set_owner(uint64_t owner);
+    uint64_t get_owner() const;
+    cache_category_t get_category() const;
+
+    /**
+     * Never evict the resource while @in_use returns true, e.g. because
+     * evicting would only drop the cache's reference to it.
+     */
+    void set_in_use(std::function<bool()> in_use);
+
+  private:
+    friend class texture_budget_t;
+
+    cache_category_t category;
+    std::function<void()> evict;
+    std::function<bool()> in_use;
+    uint64_t owner = 0;
+    size_t bytes   = 0;
+    bool linked  = false;
+    /** texture_budget_t::frame_serial when last charged or touched */
+    uint64_t last_used = 0;
+    std::list<cache_entry_t*>::iterator position;
+};
+
+/**
+ * A texture which a cache hands out to the decorations drawing it.
+ *
+ * Decorations hold the texture through aliases made by hand_out(). It stays
+ * charged against the budget until the last of them is dropped, whether or
+ * not it is still cached, and is not evicted while any is held: that would
+ * drop the cache's reference but free nothing.
+ */
+struct shared_texture_t
+{
+    shared_texture_t(std::shared_ptr<wf::owned_texture_t> texture,
+        cache_category_t category, std::function<void()> evict);
+
+    std::shared_ptr<wf::owned_texture_t> texture;
+    cache_entry_t entry;
+
+    /**
+     * Wrap a texture of @bytes for a cache.
+     * @param evict Drops the cache's reference; only called while no
+     *   decoration holds the texture.
+     */
+    static std::shared_ptr<shared_texture_t> create(
+        std::shared_ptr<wf::owned_texture_t> texture, size_t bytes,
+        cache_category_t category, std::function<void()> evict);
+
+    /**
+     * @return A reference to the texture which keeps it charged. With an
+     *   @owner, it is also counted as held by that owner until the last copy
+     *   of the reference is dropped, see texture_budget_t::get_owner_held().
+     */
+    static std::shared_ptr<wf::owned_texture_t> hand_out(
+        const std::shared_ptr<shared_texture_t>& shared, uint64_t owner = 0);
+
+    /** Call before the cache drops its reference, so the texture stays
+     * charged and is never evicted while decorations still hold it. */
+    void uncache();
+};
+
+/**
+ * Rendered window titles shared by all decorations.
+ *
+ * Terminals and browsers flip between a handful of titles, and many windows
+ * share one, so rendered titles are kept by a key describing everything that
+ * affects their pixels. Each title is also a cache_entry_t, so titles count
+ * against the texture budget like any other texture.
+ */
+class title_cache_t
+{
+  public:
+    static title_cache_t& get();
+
+    /**
+     * @param owner The decoration the title is handed out to, 0 if none
+     * @return The cached texture for @key, or nullptr
+     */
+    std::shared_ptr<wf::owned_texture_t> find(const std::string& key, uint64_t owner = 0);
+    /**
+     * Add a freshly rendered title of @bytes, dropping the oldest title no
+     * decoration shows if full.
+     * @return The texture to show, see shared_texture_t
+     */
+    std::shared_ptr<wf::owned_texture_t> insert(const std::string& key,
+        std::shared_ptr<wf::owned_texture_t> tex, size_t bytes, uint64_t owner = 0);
+    /** Drop all titles. Textures still shown by a decoration stay alive and
+     * charged until they are replaced. */
+    void clear();
+    /** @return Number of cached titles */
+    size_t size() const;
+
+  private:
+    title_cache_t() = default;
+
+    /** Titles no decoration shows are dropped beyond this many. Shown ones
+     * never are, so with more windows than that the cache simply grows. */
+    static constexpr size_t MAX_TITLES = 64;
+
+    struct title_t
+    {
+        std::string key;
+        std::shared_ptr<shared_texture_t> shared;
+    };
+
+    /* Most recently used first */
+    std::list<title_t> titles;
+    std::unordered_map<std::string, std::list<title_t>::iterator> index;
+
+    void erase(const std::string& key);
+};
+
+/**
+ * Results of the theme file lookups, shared by all decorations.
+ *
+ * Finding an icon or titlebutton asset probes many candidate paths, and every
+ * decoration of every window asks for the same files. Misses are cached as
+ * an empty path. The cache is cleared whenever the themes are reloaded.
+ */
+class path_lookup_cache_t
+{
+  public:
+    static path_lookup_cache_t& get();
+
+    /** @return Whether @key was looked up before, with the result in @path */
+    bool find(const std::string& key, std::string& path) const;
+    void insert(const std::string& key, const std::string& path);
+    void clear();
+
+  private:
+    path_lookup_cache_t() = default;
+    std::unordered_map<std::string, std::string> paths;
+};
+}
+}
@@ -0,0 +1,484 @@
+#include "deco-compare.hpp"
+#include "deco-assets.hpp"
+#include "deco-glyphs.hpp"
+#include "deco-shader.hpp"
+#include "deco-theme.hpp"
+#include "deco-trace.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/render.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/plugins/ipc/ipc-helpers.hpp>
+#include <cairo.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+using draw_callback_t = std::function<void (const wf::scene::render_instruction_t&)>;
+
+/** Lets a theme draw into a render pass outside of the scene graph */
+class callback_instance_t : public wf::scene::render_instance_t
+{
+  public:
+    explicit callback_instance_t(draw_callback_t draw) : draw(std::move(draw))
+    {}
+
+    void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::regionf_t& damage) override
+    {
+        instructions.push_back(wf::scene::render_instruction_t{
+            .instance = this,
+            .target   = target,
+            .damage   = damage,
+        });
+    }
+
+    void render(const wf::scene::render_instruction_t& data) override
+    {
+        draw(data);
+    }
+
+  private:
+    draw_callback_t draw;
+};
+
+/** The pixels one renderer produced for one case, and how long it took */
+struct rendering_t
+{
+    int width  = 0;
+    int height = 0;
+    /** Premultiplied RGBA, as read back from the buffer */
+    std::vector<uint8_t> pixels;
+    /** With the renderer's caches empty for this case, and drawn again */
+    int64_t cold_us = 0;
+    int64_t warm_us = 0;
+};
+
+/**
+ * Draw @draw into a transparent buffer covering @box twice, timing both
+ * frames up to when the GPU has finished them, and read the result back.
+ *
+ * @param reset Empties the renderer's caches before the first frame
+ */
+static rendering_t render_offscreen(wf::geometry_t box, double scale,
+    const draw_callback_t& draw, const std::function<void()>& reset = nullptr)
+{
+    DECO_TRACE_SPAN("render_offscreen");
+    rendering_t result;
+    result.width  = std::ceil(box.width * scale);
+    result.height = std::ceil(box.height * scale);
+
+    wf::auxilliary_buffer_t buffer;
+    if (!buffer.allocate({result.width, result.height}, scale))
+    {
+        return {};
+    }
+
+    wf::render_target_t target{buffer};
+    target.geometry = box;
+    target.scale    = scale;
+
+    std::vector<wf::scene::render_instance_uptr> instances;
+    instances.push_back(std::make_unique<callback_instance_t>(draw));
+
+    wf::render_pass_params_t params;
+    params.instances = &instances;
+    params.target    = target;
+    params.damage   |= box;
+    params.background_color = {0.0, 0.0, 0.0, 0.0};
+    params.flags = wf::RPASS_CLEAR_BACKGROUND;
+
+    if (reset)
+    {
+        reset();
+    }
+
+    for (int64_t *elapsed : {&result.cold_us, &result.warm_us})
+    {
+        auto start = std::chrono::steady_clock::now();
+        wf::render_pass_t::run(params);
+        wf::gles::run_in_context_if_gles([&]
+        {
+            GL_CALL(glFinish());
+        });
+        *elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    result.pixels.resize(static_cast<size_t>(result.width) * result.height * 4);
+    wf::gles::run_in_context_if_gles([&]
+    {
+        wf::gles::bind_render_buffer(target);
+        GL_CALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        GL_CALL(glReadPixels(0, 0, result.width, result.height, GL_RGBA, GL_UNSIGNED_BYTE,
+            result.pixels.data()));
+    });
+
+    buffer.free();
+    return result;
+}
+
+/** Write a rendering as PNG, for looking at what differs */
+static void write_png(const rendering_t& image, const std::string& path)
+{
+    auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, image.width, image.height);
+    cairo_surface_flush(surface);
+    uint8_t *data    = cairo_image_surface_get_data(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < image.height; y++)
+    {
+        auto row = reinterpret_cast<uint32_t*>(data + y * stride);
+        const uint8_t *src = &image.pixels[static_cast<size_t>(y) * image.width * 4];
+        for (int x = 0; x < image.width; x++, src += 4)
+        {
+            row[x] = (uint32_t(src[3]) << 24) | (uint32_t(src[0]) << 16) |
+                (uint32_t(src[1]) << 8) | src[2];
+        }
+    }
+
+    cairo_surface_mark_dirty(surface);
+    cairo_surface_write_to_png(surface, path.c_str());
+    cairo_surface_destroy(surface);
+}
+
+/**
+ * Compare a candidate renderer with the reference and describe the case.
+ * @return Whether no pixel differs by more than @tolerance in any channel
+ */
+static bool compare_case(const rendering_t& reference, const rendering_t& candidate,
+    int tolerance, const std::string& dump_prefix, wf::json_t& result)
+{
+    size_t mismatched  = 0;
+    int max_difference = 0;
+    if ((reference.width != candidate.width) || (reference.height != candidate.height) ||
+        reference.pixels.empty())
+    {
+        mismatched = std::max(reference.pixels.size(), candidate.pixels.size()) / 4;
+        max_difference = 255;
+    } else
+    {
+        for (size_t i = 0; i < reference.pixels.size(); i += 4)
+        {
+            int difference = 0;
+            for (size_t c = 0; c < 4; c++)
+            {
+                difference = std::max(difference,
+                    std::abs(int(reference.pixels[i + c]) - int(candidate.pixels[i + c])));
+            }
+
+            max_difference = std::max(max_difference, difference);
+            mismatched    += (difference > tolerance);
+        }
+    }
+
+    const auto timings = [] (const rendering_t& image)
+    {
+        wf::json_t us;
+        us["cold"] = image.cold_us;
+        us["warm"] = image.warm_us;
+        return us;
+    };
+
+    result["mismatched-pixels"] = (int64_t)mismatched;
+    result["max-difference"]    = max_difference;
+    result["reference-us"] = timings(reference);
+    result["candidate-us"] = timings(candidate);
+
+    const bool passed = (mismatched == 0);
+    result["passed"] = passed;
+    if (!passed && !dump_prefix.empty() && !reference.pixels.empty() &&
+        !candidate.pixels.empty())
+    {
+        write_png(reference, dump_prefix + "-reference.png");
+        write_png(candidate, dump_prefix + "-candidate.png");
+    }
+
+    return passed;
+}
+
+/** Compares the renderers of one theme, see compare_renderers() */
+struct theme_comparison_t
+{
+    theme_comparison_t(const std::string& theme_name, const std::string& icon_theme,
+        int tolerance, const std::string& dump_dir, wf::json_t& cases) :
+        theme_name(theme_name), icon_theme(icon_theme), tolerance(tolerance),
+        dump_dir(dump_dir), cases(cases)
+    {}
+
+    std::string theme_name;
+    std::string icon_theme;
+    int tolerance;
+    std::string dump_dir;
+    wf::json_t& cases;
+    int failed = 0;
+
+    /** One theme per renderer, each with its own caches */
+    decoration_theme_t cairo_theme, gpu_theme;
+
+    void add_case(const std::string& name, const rendering_t& reference,
+        const rendering_t& candidate, wf::json_t& result)
+    {
+        const std::string prefix = theme_name.empty() ? name : theme_name + "-" + name;
+        result["theme"] = theme_name;
+        failed += !compare_case(reference, candidate, tolerance,
+            dump_dir.empty() ? dump_dir : dump_dir + "/" + prefix, result);
+        cases.append(result);
+    }
+
+    void compare_frames()
+    {
+        static const std::vector<wf::dimensions_t> sizes = {{320, 200}, {800, 600}, {1920, 1080}};
+        for (auto size : sizes)
+        {
+            for (double scale : {1.0, 1.25, 2.0})
+            {
+                for (bool active : {true, false})
+                {
+                    const wf::geometry_t frame = {0, 0, (double)size.width, (double)size.height};
+                    const int extent = std::max(cairo_theme.get_shadow_extent(),
+                        gpu_theme.get_shadow_extent());
+                    const wf::geometry_t box = {
+                        frame.x - extent, frame.y - extent,
+                        frame.width + 2.0 * extent, frame.height + 2.0 * extent
+                    };
+
+                    auto draw_with = [&] (const decoration_theme_t& theme)
+                    {
+                        return render_offscreen(box, scale,
+                            [&] (const wf::scene::render_instruction_t& data)
+                        {
+                            theme.render_background(data, frame, active);
+                        }, [&] { theme.clear_frame_cache(); });
+                    };
+
+                    wf::json_t result;
+                    result["kind"]      = "frame";
+                    result["width"]     = size.width;
+                    result["height"]    = size.height;
+                    result["scale"]     = scale;
+                    result["active"]    = active;
+                    result["reference"] = "cairo";
+                    result["candidate"] = "shader";
+                    add_case("frame-" + std::to_string(size.width) + "x" +
+                        std::to_string(size.height) + "@" + std::to_string(scale) +
+                        (active ? "-active" : "-inactive"),
+                        draw_with(cairo_theme), draw_with(gpu_theme), result);
+                }
+            }
+        }
+    }
+
+    /**
+     * Buttons drawn by get_button_surface() against the theme pixmaps of the
+     * asset cache, which decorations show instead where the theme has them
+     */
+    void compare_buttons()
+    {
+        for (auto button : {BUTTON_CLOSE, BUTTON_TOGGLE_MAXIMIZE, BUTTON_MINIMIZE})
+        {
+            for (double scale : {1.0, 2.0})
+            {
+                for (bool active : {true, false})
+                {
+                    for (double hover : {0.0, 1.0, -1.0})
+                    {
+                        const decoration_theme_t::button_state_t state = {
+                            .width  = cairo_theme.get_button_size(scale),
+                            .height = cairo_theme.get_button_size(scale),
+                            .border = 2.0,
+                            .hover_progress = hover,
+                            .activated = active,
+                        };
+
+                        /* Icon theme buttons are only ever drawn by cairo */
+                        if (!gpu_theme.get_button_texture(button, state))
+                        {
+                            continue;
+                        }
+
+                        const wf::geometry_t geometry = {
+                            0, 0, state.width / scale, state.height / scale
+                        };
+                        std::unique_ptr<wf::owned_texture_t> texture;
+                        auto reference = render_offscreen(geometry, scale,
+                            [&] (const wf::scene::render_instruction_t& data)
+                        {
+                            auto surface = cairo_theme.get_button_surface(button, state);
+                            texture = std::make_unique<wf::owned_texture_t>(surface);
+                            cairo_surface_destroy(surface);
+                            data.pass->add_texture(texture->get_texture(), data.target,
+                                geometry, data.damage);
+                        });
+
+                        auto candidate = render_offscreen(geometry, scale,
+                            [&] (const wf::scene::render_instruction_t& data)
+                        {
+                            if (auto pixmap = gpu_theme.get_button_texture(button, state))
+                            {
+                                data.pass->add_texture(pixmap->get_texture(), data.target,
+                                    geometry, data.damage);
+                            }
+                        }, [] { asset_cache_t::get().clear(); });
+
+                        wf::json_t result;
+                        result["kind"]      = "button";
+                        result["button"]    = (int)button;
+                        result["scale"]     = scale;
+                        result["active"]    = active;
+                        result["hover"]     = hover;
+                        result["reference"] = "cairo";
+                        result["candidate"] = "asset";
+                        add_case("button-" + std::to_string(button) + "@" +
+                            std::to_string(scale) + (active ? "-active" : "-inactive") +
+                            "-hover" + std::to_string(hover), reference, candidate, result);
+                    }
+                }
+            }
+        }
+    }
+
+    void compare_titles()
+    {
+        static const std::vector<std::string> titles = {
+            "Terminal", "README.md — ~/src/gtkdecor — Text Editor",
+            "Ελληνικά · Русский · 日本語 · 한국어 🙂",
+        };
+
+        const int title_height = cairo_theme.get_title_height();
+        for (size_t i = 0; i < titles.size(); i++)
+        {
+            for (double scale : {1.0, 1.25, 2.0})
+            {
+                const wf::geometry_t geometry = {0, 0, 480, (double)title_height};
+                const std::string& text = titles[i];
+
+                std::unique_ptr<wf::owned_texture_t> texture;
+                auto reference = render_offscreen(geometry, scale,
+                    [&] (const wf::scene::render_instruction_t& data)
+                {
+                    auto surface = cairo_theme.render_text(text, geometry.width * scale,
+                        geometry.height * scale);
+                    texture = std::make_unique<wf::owned_texture_t>(surface);
+                    cairo_surface_destroy(surface);
+                    data.pass->add_texture(texture->get_texture(), data.target, geometry,
+                        data.damage);
+                });
+
+                /* Cold means without any glyph rasterized yet */
+                glyph_run_t run;
+                auto candidate = render_offscreen(geometry, scale,
+                    [&] (const wf::scene::render_instruction_t& data)
+                {
+                    gpu_theme.render_title_glyphs(data, run, text, geometry, 0);
+                }, [] { glyph_atlas_t::get().clear(); });
+
+                wf::json_t result;
+                result["kind"]      = "title";
+                result["text"]      = text;
+                result["scale"]     = scale;
+                result["reference"] = "cairo";
+                result["candidate"] = "atlas";
+                add_case("title-" + std::to_string(i) + "@" + std::to_string(scale),
+                    reference, candidate, result);
+            }
+        }
+    }
+
+    void run()
+    {
+        for (auto theme : {&cairo_theme, &gpu_theme})
+        {
+            theme->set_theme_names(theme_name, icon_theme);
+            theme->set_buttons(button_type_t(BUTTON_CLOSE | BUTTON_TOGGLE_MAXIMIZE |
+                BUTTON_MINIMIZE));
+            theme->reload_theme();
+        }
+
+        cairo_theme.set_renderers("cairo", "cairo");
+        gpu_theme.set_renderers("shader", "atlas");
+
+        /* Loading the theme is not part of any renderer's timings */
+        for (auto theme : {&cairo_theme, &gpu_theme})
+        {
+            render_offscreen({0, 0, 64, 64}, 1.0,
+                [=] (const wf::scene::render_instruction_t& data)
+            {
+                theme->render_background(data, {0, 0, 64, 64}, true);
+            });
+        }
+
+        compare_frames();
+        compare_buttons();
+        compare_titles();
+    }
+};
+
+wf::json_t compare_renderers(const wf::json_t& request)
+{
+    if (!decoration_shaders_t::is_supported())
+    {
+        return wf::ipc::json_error("Comparing renderers needs the GLES renderer");
+    }
+
+    int tolerance = 2;
+    if (request.has_member("tolerance") && request["tolerance"].is_int())
+    {
+        tolerance = std::clamp(request["tolerance"].as_int(), 0, 255);
+    }
+
+    std::string dump_dir;
+    if (request.has_member("dump-dir") && request["dump-dir"].is_string())
+    {
+        dump_dir = request["dump-dir"].as_string();
+    }
+
+    /* The GTK theme in use, or the listed ones */
+    std::vector<std::string> themes = {""};
+    if (request.has_member("themes") && request["themes"].is_array())
+    {
+        themes.clear();
+        for (size_t i = 0; i < request["themes"].size(); i++)
+        {
+            if (request["themes"][i].is_string())
+            {
+                themes.push_back(request["themes"][i].as_string());
+            }
+        }
+    }
+
+    std::string icon_theme;
+    if (request.has_member("icon-theme") && request["icon-theme"].is_string())
+    {
+        icon_theme = request["icon-theme"].as_string();
+    }
+
+    wf::json_t cases = wf::json_t::array();
+    wf::json_t theme_names = wf::json_t::array();
+    int failed = 0;
+    for (const auto& theme_name : themes)
+    {
+        theme_names.append(theme_name);
+        theme_comparison_t comparison(theme_name, icon_theme, tolerance, dump_dir, cases);
+        comparison.run();
+        failed += comparison.failed;
+    }
+
+    auto response = wf::ipc::json_ok();
+    response["themes"]    = theme_names;
+    response["tolerance"] = tolerance;
+    response["failed"]    = failed;
+    response["cases"]     = cases;
+    return response;
+}
+}
+}
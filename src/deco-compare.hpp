@@ -0,0 +1,30 @@
+#pragma once
+#include <wayfire/nonstd/json.hpp>
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * Render decorations offscreen through every renderer and compare the
+ * results with the cairo renderer, pixel by pixel.
+ *
+ * Frames are drawn with frame_renderer = cairo and shader, titles with
+ * title_renderer = cairo and atlas, at a matrix of sizes, scales and focus
+ * states. Buttons drawn by cairo are compared with the theme's pixmaps from
+ * the asset cache, where the theme has them. Every case reports the pixels
+ * which differ by more than the tolerance and how long each renderer took,
+ * once with the renderer's caches and the glyph atlas emptied and once more
+ * for the same frame.
+ *
+ * Needs the GLES renderer, like the renderers being compared.
+ *
+ * @param request Optional "tolerance" (per channel, default 2), "dump-dir",
+ *   where both images of every failing case are written as PNG, "themes",
+ *   the GTK themes to compare with instead of the current one, and
+ *   "icon-theme" to use with them.
+ * @return The IPC response of gtkdecor/compare-renderers
+ */
+wf::json_t compare_renderers(const wf::json_t& request);
+}
+}
@@ -0,0 +1,447 @@
+#include "deco-glyphs.hpp"
+#include "deco-arena.hpp"
+#include "deco-stats.hpp"
+#include "deco-trace.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/debug.hpp>
+#include <pango/pangocairo.h>
+#include <algorithm>
+#include <cmath>
+
+namespace wf
+{
+namespace decor
+{
+static const char *glyph_vertex_source =
+    R"(
+#version 100
+attribute mediump vec2 position;
+attribute mediump vec2 uv;
+attribute mediump vec4 tint;
+uniform mat4 matrix;
+varying mediump vec2 frag_uv;
+varying mediump vec4 frag_tint;
+
+void main()
+{
+    frag_uv     = uv;
+    frag_tint   = tint;
+    gl_Position = matrix * vec4(position, 0.0, 1.0);
+}
+)";
+
+/* Monochrome glyphs are stored white, so the premultiplied tint gives them
+ * the title color; color glyphs are tinted with the title's alpha only. */
+static const char *glyph_fragment_source =
+    R"(
+#version 100
+precision mediump float;
+uniform sampler2D atlas;
+varying mediump vec2 frag_uv;
+varying mediump vec4 frag_tint;
+
+void main()
+{
+    gl_FragColor = texture2D(atlas, frag_uv) * frag_tint;
+}
+)";
+
+glyph_atlas_t& glyph_atlas_t::get()
+{
+    static glyph_atlas_t atlas;
+    return atlas;
+}
+
+static bool same_layout(const title_params_t& a, const title_params_t& b)
+{
+    return (a.text == b.text) && (a.width == b.width) && (a.height == b.height) &&
+           (a.button_area_width == b.button_area_width) && (a.font == b.font);
+}
+
+bool glyph_atlas_t::render(const wf::scene::render_instruction_t& data, glyph_run_t& run,
+    const title_params_t& params, wf::geometry_t geometry, double scale)
+{
+    if (run.overflowed && same_layout(run.params, params))
+    {
+        /* Clearing the atlas again would not make room, only drop the others */
+        return false;
+    }
+
+    if ((run.generation != generation) || !same_layout(run.params, params))
+    {
+        run.params = params;
+        run.overflowed = !layout(run);
+        if (run.overflowed)
+        {
+            /* Start over on an empty atlas */
+            decoration_stats_t::global().count(STAT_GLYPH_ATLAS_OVERFLOW);
+            clear();
+            run.overflowed = !layout(run);
+        }
+
+        run.generation = generation;
+        if (run.overflowed)
+        {
+            if (!overflow_reported)
+            {
+                LOGI("Title glyphs do not fit in a ", ATLAS_SIZE, "x", ATLAS_SIZE,
+                    " atlas; drawing such titles from textures instead");
+                overflow_reported = true;
+            }
+
+            return false;
+        }
+    }
+
+    if (run.quads.empty())
+    {
+        return true;
+    }
+
+    if (entry)
+    {
+        entry->touch();
+    }
+
+    const wf::color_t& c = params.color;
+    const GLfloat text_tint[]  = {
+        GLfloat(c.r * c.a), GLfloat(c.g * c.a), GLfloat(c.b * c.a), GLfloat(c.a)
+    };
+    const GLfloat color_tint[] = {GLfloat(c.a), GLfloat(c.a), GLfloat(c.a), GLfloat(c.a)};
+
+    /* GLES2 has no instancing, so every glyph is two triangles of one batch */
+    std::vector<GLfloat> positions, uvs, tints;
+    positions.reserve(run.quads.size() * 12);
+    uvs.reserve(run.quads.size() * 12);
+    tints.reserve(run.quads.size() * 24);
+    for (const auto& quad : run.quads)
+    {
+        const GLfloat x1 = geometry.x + quad.x / scale;
+        const GLfloat y1 = geometry.y + quad.y / scale;
+        const GLfloat x2 = x1 + quad.width / scale;
+        const GLfloat y2 = y1 + quad.height / scale;
+        positions.insert(positions.end(), {x1, y1, x2, y1, x2, y2, x1, y1, x2, y2, x1, y2});
+        uvs.insert(uvs.end(), {
+            quad.u1, quad.v1, quad.u2, quad.v1, quad.u2, quad.v2,
+            quad.u1, quad.v1, quad.u2, quad.v2, quad.u1, quad.v2,
+        });
+
+        const GLfloat *tint = quad.color ? color_tint : text_tint;
+        for (int i = 0; i < 6; i++)
+        {
+            tints.insert(tints.end(), tint, tint + 4);
+        }
+    }
+
+    data.pass->custom_gles_subpass(data.target, [&]
+    {
+        if (!program_compiled)
+        {
+            program.set_simple(OpenGL::compile_program(glyph_vertex_source, glyph_fragment_source));
+            program_compiled = true;
+        }
+
+        upload();
+        wf::gles::bind_render_buffer(data.target);
+        program.use(wf::TEXTURE_TYPE_RGBA);
+        program.attrib_pointer("position", 2, 0, positions.data());
+        program.attrib_pointer("uv", 2, 0, uvs.data());
+        program.attrib_pointer("tint", 4, 0, tints.data());
+        program.uniformMatrix4f("matrix",
+            wf::gles::render_target_orthographic_projection(data.target));
+
+        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+        program.uniform1i("atlas", 0);
+
+        GL_CALL(glEnable(GL_BLEND));
+        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        for (const auto& damaged : data.damage)
+        {
+            wf::gles::render_target_logic_scissor(data.target, damaged);
+            GL_CALL(glDrawArrays(GL_TRIANGLES, 0, positions.size() / 2));
+        }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        program.deactivate();
+    });
+
+    return true;
+}
+
+bool glyph_atlas_t::layout(glyph_run_t& run)
+{
+    DECO_TRACE_SPAN("layout_title_glyphs");
+    run.quads.clear();
+    if ((run.params.width <= 0) || (run.params.height <= 0))
+    {
+        return true;
+    }
+
+    auto context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+    wf::point_t offset;
+    PangoLayout *layout = decoration_theme_t::create_title_layout(context, run.params, offset);
+
+    bool overflow = false;
+    PangoLayoutIter *iter = pango_layout_get_iter(layout);
+    do
+    {
+        PangoLayoutRun *item = pango_layout_iter_get_run_readonly(iter);
+        if (!item)
+        {
+            continue;
+        }
+
+        PangoRectangle logical;
+        pango_layout_iter_get_run_extents(iter, nullptr, &logical);
+        const int baseline = pango_layout_iter_get_baseline(iter);
+        PangoFont *font    = item->item->analysis.font;
+
+        /* Glyphs are stored in visual order, advancing from the run's left edge */
+        int x = logical.x;
+        for (int i = 0; (i < item->glyphs->num_glyphs) && !overflow; i++)
+        {
+            const PangoGlyphInfo& info = item->glyphs->glyphs[i];
+            const int origin_x = x + info.geometry.x_offset;
+            const int origin_y = baseline + info.geometry.y_offset;
+            x += info.geometry.width;
+
+            if ((info.glyph == PANGO_GLYPH_EMPTY) || (info.glyph & PANGO_GLYPH_UNKNOWN_FLAG))
+            {
+                continue;
+            }
+
+            const glyph_t *glyph = find_glyph(font, info.glyph, overflow);
+            if (!glyph || (glyph->width == 0))
+            {
+                continue;
+            }
+
+            run.quads.push_back(glyph_run_t::quad_t{
+                .x     = float(offset.x + PANGO_PIXELS(origin_x) + glyph->bearing_x),
+                .y     = float(offset.y + PANGO_PIXELS(origin_y) + glyph->bearing_y),
+                .width = float(glyph->width),
+                .height = float(glyph->height),
+                .u1    = float(glyph->x) / ATLAS_SIZE,
+                .v1    = float(glyph->y) / ATLAS_SIZE,
+                .u2    = float(glyph->x + glyph->width) / ATLAS_SIZE,
+                .v2    = float(glyph->y + glyph->height) / ATLAS_SIZE,
+                .color = glyph->color,
+            });
+        }
+    } while (!overflow && pango_layout_iter_next_run(iter));
+
+    pango_layout_iter_free(iter);
+    g_object_unref(layout);
+    g_object_unref(context);
+
+    if (overflow)
+    {
+        run.quads.clear();
+    }
+
+    return !overflow;
+}
+
+const glyph_atlas_t::glyph_t*glyph_atlas_t::find_glyph(PangoFont *font, uint32_t glyph,
+    bool& overflow)
+{
+    auto font_it = fonts.find(font);
+    if (font_it == fonts.end())
+    {
+        g_object_ref(font);
+        font_it = fonts.emplace(font, fonts.size()).first;
+    }
+
+    const auto key = std::make_pair(font_it->second, glyph);
+    auto it = glyphs.find(key);
+    if (it != glyphs.end())
+    {
+        return &it->second;
+    }
+
+    glyph_t result{0, 0, 0, 0, 0, 0, false};
+    cairo_scaled_font_t *scaled = pango_cairo_font_get_scaled_font(PANGO_CAIRO_FONT(font));
+    if (!scaled)
+    {
+        return &(glyphs[key] = result);
+    }
+
+    cairo_glyph_t cairo_glyph{glyph, 0, 0};
+    cairo_text_extents_t extents;
+    cairo_scaled_font_glyph_extents(scaled, &cairo_glyph, 1, &extents);
+    if ((extents.width <= 0) || (extents.height <= 0))
+    {
+        /* Spaces and other blank glyphs */
+        return &(glyphs[key] = result);
+    }
+
+    /* One transparent pixel around each glyph keeps the filtering clean */
+    const int left   = std::floor(extents.x_bearing) - 1;
+    const int top    = std::floor(extents.y_bearing) - 1;
+    const int width  = std::ceil(extents.x_bearing + extents.width) + 1 - left;
+    const int height = std::ceil(extents.y_bearing + extents.height) + 1 - top;
+    if ((width > ATLAS_SIZE) || (height > ATLAS_SIZE))
+    {
+        return &(glyphs[key] = result);
+    }
+
+    if (shelf_x + width > ATLAS_SIZE)
+    {
+        shelf_y += shelf_height;
+        shelf_x  = 0;
+        shelf_height = 0;
+    }
+
+    if (shelf_y + height > ATLAS_SIZE)
+    {
+        overflow = true;
+        return nullptr;
+    }
+
+    if (pixels.empty())
+    {
+        pixels.assign(size_t(ATLAS_SIZE) * ATLAS_SIZE * 4, 0);
+        if (!entry)
+        {
+            entry = std::make_unique<cache_entry_t>(CACHE_GLYPH_ATLAS, [this] ()
+            {
+                clear();
+                std::vector<uint8_t>().swap(pixels);
+                wf::gles::run_in_context_if_gles([&]
+                {
+                    if (texture_allocated)
+                    {
+                        GL_CALL(glDeleteTextures(1, &texture));
+                    }
+                });
+                texture_allocated = false;
+            });
+        }
+
+        /* The CPU copy and the texture */
+        entry->charge(2 * pixels.size());
+    }
+
+    DECO_TRACE_SPAN("rasterize_glyph");
+    decoration_stats_t::global().count(STAT_GLYPH_RASTER);
+
+    auto surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32, width, height);
+    auto cr = cairo_create(surface);
+    cairo_set_scaled_font(cr, scaled);
+    cairo_set_source_rgba(cr, 1, 1, 1, 1);
+    cairo_glyph.x = -left;
+    cairo_glyph.y = -top;
+    cairo_show_glyphs(cr, &cairo_glyph, 1);
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+
+    /* Premultiplied ARGB words to RGBA bytes. Anything that is not gray
+     * comes from a color font and must not be tinted. */
+    const uint8_t *data = cairo_image_surface_get_data(surface);
+    const int stride    = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < height; y++)
+    {
+        const uint32_t *src = reinterpret_cast<const uint32_t*>(data + y * stride);
+        uint8_t *dst = &pixels[(size_t(shelf_y + y) * ATLAS_SIZE + shelf_x) * 4];
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t a = src[x] >> 24;
+            const uint8_t r = src[x] >> 16;
+            const uint8_t g = src[x] >> 8;
+            const uint8_t b = src[x];
+            result.color |= (r != g) || (g != b);
+            dst[x * 4 + 0] = r;
+            dst[x * 4 + 1] = g;
+            dst[x * 4 + 2] = b;
+            dst[x * 4 + 3] = a;
+        }
+    }
+
+    cairo_surface_destroy(surface);
+
+    result.x = shelf_x;
+    result.y = shelf_y;
+    result.width     = width;
+    result.height    = height;
+    result.bearing_x = left;
+    result.bearing_y = top;
+
+    dirty_top    = std::min(dirty_top, shelf_y);
+    dirty_bottom = std::max(dirty_bottom, shelf_y + height);
+    shelf_x += width;
+    shelf_height = std::max(shelf_height, height);
+
+    return &(glyphs[key] = result);
+}
+
+void glyph_atlas_t::clear()
+{
+    for (auto& font : fonts)
+    {
+        g_object_unref(font.first);
+    }
+
+    fonts.clear();
+    glyphs.clear();
+    std::fill(pixels.begin(), pixels.end(), 0);
+    shelf_x = shelf_y = shelf_height = 0;
+    dirty_top    = ATLAS_SIZE;
+    dirty_bottom = 0;
+    generation++;
+}
+
+void glyph_atlas_t::upload()
+{
+    if (pixels.empty())
+    {
+        return;
+    }
+
+    if (!texture_allocated)
+    {
+        GL_CALL(glGenTextures(1, &texture));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_SIZE, ATLAS_SIZE, 0,
+            GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+        texture_allocated = true;
+    } else if (dirty_top < dirty_bottom)
+    {
+        /* GLES2 cannot upload a sub-rectangle of a larger image, so whole rows */
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, texture));
+        GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirty_top, ATLAS_SIZE,
+            dirty_bottom - dirty_top, GL_RGBA, GL_UNSIGNED_BYTE,
+            &pixels[size_t(dirty_top) * ATLAS_SIZE * 4]));
+    }
+
+    dirty_top    = ATLAS_SIZE;
+    dirty_bottom = 0;
+}
+
+void glyph_atlas_t::fini()
+{
+    wf::gles::run_in_context_if_gles([&]
+    {
+        if (texture_allocated)
+        {
+            GL_CALL(glDeleteTextures(1, &texture));
+        }
+
+        if (program_compiled)
+        {
+            program.free_resources();
+        }
+    });
+
+    texture_allocated = false;
+    program_compiled  = false;
+    clear();
+    std::vector<uint8_t>().swap(pixels);
+    entry.reset();
+}
+}
+}
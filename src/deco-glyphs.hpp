@@ -0,0 +1,117 @@
+#pragma once
+#include <wayfire/opengl.hpp>
+#include <wayfire/scene-render.hpp>
+#include "deco-cache.hpp"
+#include "deco-theme.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/** A title laid out as quads into the glyph atlas */
+struct glyph_run_t
+{
+    struct quad_t
+    {
+        /** Position and size in output pixels, relative to the title */
+        float x, y, width, height;
+        /** Texture coordinates in the atlas */
+        float u1, v1, u2, v2;
+        /** Color glyphs (emoji) keep their own colors instead of the title's */
+        bool color;
+    };
+
+    std::vector<quad_t> quads;
+    /** What the quads were laid out for */
+    title_params_t params{};
+    /** The atlas generation the texture coordinates refer to */
+    uint64_t generation = 0;
+    /** The params do not fit in an empty atlas, so there are no quads */
+    bool overflowed = false;
+};
+
+/**
+ * Glyphs of the title fonts, rasterized once and shared by all decorations
+ * in a single GPU texture. Titles are drawn as one batch of textured quads
+ * per damaged box, so a changed title costs a new layout and at most the
+ * upload of the glyphs it has not used before.
+ *
+ * Only GLES2 core features are used. When the atlas is full, it is cleared
+ * and the visible titles are laid out again. A title which does not fit even
+ * in an empty atlas is left to the caller, see render().
+ */
+class glyph_atlas_t
+{
+  public:
+    static glyph_atlas_t& get();
+
+    /**
+     * Draw a title, laying it out again if @params or the atlas changed.
+     *
+     * @param params The title, laid out in output pixels
+     * @param geometry Where the title goes, in logical coordinates
+     * @param scale Output pixels per logical pixel
+     * @return false, without drawing, if the title does not fit in an empty
+     *   atlas. It should then be drawn from a texture instead.
+     */
+    bool render(const wf::scene::render_instruction_t& data, glyph_run_t& run,
+        const title_params_t& params, wf::geometry_t geometry, double scale);
+
+    /** Free the atlas and its GL resources */
+    void fini();
+
+    /** Drop all glyphs, e.g. when the atlas is full or to measure it cold */
+    void clear();
+
+  private:
+    glyph_atlas_t() = default;
+
+    static constexpr int ATLAS_SIZE = 1024;
+
+    struct glyph_t
+    {
+        /** Position and size in the atlas, 0x0 for glyphs without pixels */
+        int x, y, width, height;
+        /** Offset of the glyph's top-left corner from its origin */
+        int bearing_x, bearing_y;
+        bool color;
+    };
+
+    /** Fonts in use, referenced until the atlas is cleared */
+    std::map<PangoFont*, int> fonts;
+    /** Keyed by font index and glyph id */
+    std::map<std::pair<int, uint32_t>, glyph_t> glyphs;
+
+    /** RGBA, premultiplied. Empty until the first glyph is added. */
+    std::vector<uint8_t> pixels;
+    /** Rows which have to be uploaded before drawing */
+    int dirty_top    = ATLAS_SIZE;
+    int dirty_bottom = 0;
+    /** Shelf packing: the current shelf and the next free column on it */
+    int shelf_y = 0;
+    int shelf_height = 0;
+    int shelf_x = 0;
+    uint64_t generation = 1;
+
+    GLuint texture = 0;
+    bool texture_allocated = false;
+    OpenGL::program_t program;
+    bool program_compiled = false;
+    bool overflow_reported = false;
+
+    std::unique_ptr<cache_entry_t> entry;
+
+    /** Lay out @run.params and add its glyphs. @return false if the atlas overflowed. */
+    bool layout(glyph_run_t& run);
+    /** @return The glyph, rasterized and added to the atlas if necessary */
+    const glyph_t *find_glyph(PangoFont *font, uint32_t glyph, bool& overflow);
+    /** Upload the dirty rows, with the GL context current */
+    void upload();
+};
+}
+}
@@ -0,0 +1,236 @@
+#include "deco-shader.hpp"
+#include <wayfire/core.hpp>
+#include <cmath>
+#include <algorithm>
+
+namespace wf
+{
+namespace decor
+{
+static const char *deco_vertex_source =
+    R"(
+#version 100
+attribute mediump vec2 position;
+uniform mat4 matrix;
+varying highp vec2 frag_pos;
+
+void main()
+{
+    frag_pos    = position;
+    gl_Position = matrix * vec4(position, 0.0, 1.0);
+}
+)";
+
+/* Signed distance to a box whose top and bottom corners have different
+ * radii. Logical coordinates grow downwards, so the upper half of the box
+ * uses radii.x and the lower half radii.y. */
+#define DECO_ROUNDED_BOX_SDF \
+    R"(
+float rounded_box_sdf(vec2 p, vec4 box, vec2 radii)
+{
+    vec2 half_size = box.zw * 0.5;
+    vec2 q = p - (box.xy + half_size);
+    float r = (q.y < 0.0) ? radii.x : radii.y;
+    vec2 d  = abs(q) - half_size + r;
+    return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - r;
+}
+)"
+
+static const char *shadow_fragment_source =
+    R"(
+#version 100
+precision highp float;
+varying highp vec2 frag_pos;
+
+uniform vec4 color;
+uniform vec4 frame;
+uniform vec4 cutout;
+uniform vec2 radii;
+uniform float sigma;
+)" DECO_ROUNDED_BOX_SDF R"(
+/* Abramowitz & Stegun 7.1.27, GLSL ES 1.00 has no erf() */
+float erf_approx(float x)
+{
+    float s = sign(x);
+    float a = abs(x);
+    float t = 1.0 + (0.278393 + (0.230389 + 0.078108 * (a * a)) * a) * a;
+    t *= t;
+    return s - s / (t * t);
+}
+
+void main()
+{
+    /* A rounded box convolved with a Gaussian is well approximated by
+     * applying the 1D Gaussian CDF to the distance from its outline. */
+    float d = rounded_box_sdf(frag_pos, frame, radii);
+    float alpha = 0.5 - 0.5 * erf_approx(d / (sigma * 1.4142136));
+
+    /* The shadow is only visible outside the decoration itself, which
+     * matters for translucent frames and clients. */
+    float inside = clamp(0.5 - rounded_box_sdf(frag_pos, cutout, radii), 0.0, 1.0);
+    gl_FragColor = color * (alpha * (1.0 - inside));
+}
+)";
+
+static const char *frame_fragment_source =
+    R"(
+#version 100
+precision highp float;
+varying highp vec2 frag_pos;
+
+uniform vec4 fill_color;
+uniform vec4 outline_color;
+uniform vec4 frame;
+uniform vec4 content;
+uniform vec2 radii;
+)" DECO_ROUNDED_BOX_SDF R"(
+void main()
+{
+    float d = rounded_box_sdf(frag_pos, frame, radii);
+
+    /* Anti-aliased coverage of the frame, and of the 1px band inside its edge */
+    float covered = clamp(0.5 - d, 0.0, 1.0);
+    float outline = covered - clamp(-0.5 - d, 0.0, 1.0);
+
+    /* The client area stays unpainted */
+    vec2 to_content = max(content.xy - frag_pos, frag_pos - content.xy - content.zw);
+    float in_content = clamp(0.5 - max(to_content.x, to_content.y), 0.0, 1.0);
+    float fill = covered * (1.0 - in_content);
+
+    vec4 base = fill_color * fill;
+    vec4 line = outline_color * outline;
+    gl_FragColor = line + base * (1.0 - line.a);
+}
+)";
+
+decoration_shaders_t& decoration_shaders_t::get()
+{
+    static decoration_shaders_t shaders;
+    return shaders;
+}
+
+bool decoration_shaders_t::is_supported()
+{
+    return wf::get_core().is_gles2();
+}
+
+int decoration_shaders_t::get_shadow_extent(double radius, wf::pointf_t offset)
+{
+    return static_cast<int>(std::ceil(3.0 * std::max(radius, 0.0) +
+        std::max(std::abs(offset.x), std::abs(offset.y))));
+}
+
+void decoration_shaders_t::draw_quad(const wf::scene::render_instruction_t& data,
+    OpenGL::program_t& program, wf::geometry_t box)
+{
+    const GLfloat x1 = box.x;
+    const GLfloat y1 = box.y;
+    const GLfloat x2 = box.x + box.width;
+    const GLfloat y2 = box.y + box.height;
+    const GLfloat vertices[] = {
+        x1, y1,
+        x2, y1,
+        x2, y2,
+        x1, y2,
+    };
+
+    program.attrib_pointer("position", 2, 0, vertices);
+    program.uniformMatrix4f("matrix",
+        wf::gles::render_target_orthographic_projection(data.target));
+
+    GL_CALL(glEnable(GL_BLEND));
+    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    for (const auto& damaged : data.damage)
+    {
+        wf::gles::render_target_logic_scissor(data.target, damaged);
+        GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+    }
+
+    program.deactivate();
+}
+
+void decoration_shaders_t::render_shadow(const wf::scene::render_instruction_t& data,
+    const shadow_params_t& params)
+{
+    if ((params.radius <= 0) || (params.color.a <= 0))
+    {
+        return;
+    }
+
+    const double extent = get_shadow_extent(params.radius, params.offset);
+    const wf::geometry_t quad = {
+        params.frame.x - extent, params.frame.y - extent,
+        params.frame.width + 2 * extent, params.frame.height + 2 * extent,
+    };
+
+    const wf::color_t& c = params.color;
+    data.pass->custom_gles_subpass(data.target, [&]
+    {
+        if (!shadow_compiled)
+        {
+            const std::string fragment = shadow_fragment_source;
+            shadow_program.set_simple(OpenGL::compile_program(deco_vertex_source, fragment));
+            shadow_compiled = true;
+        }
+
+        wf::gles::bind_render_buffer(data.target);
+        shadow_program.use(wf::TEXTURE_TYPE_RGBA);
+        shadow_program.uniform4f("color", glm::vec4(c.r * c.a, c.g * c.a, c.b * c.a, c.a));
+        shadow_program.uniform4f("frame", glm::vec4(
+            params.frame.x + params.offset.x, params.frame.y + params.offset.y,
+            params.frame.width, params.frame.height));
+        shadow_program.uniform4f("cutout", glm::vec4(
+            params.frame.x, params.frame.y, params.frame.width, params.frame.height));
+        shadow_program.uniform2f("radii", params.top_radius, params.bottom_radius);
+        shadow_program.uniform1f("sigma", params.radius);
+        draw_quad(data, shadow_program, quad);
+    });
+}
+
+void decoration_shaders_t::render_frame(const wf::scene::render_instruction_t& data,
+    const frame_params_t& params)
+{
+    const wf::color_t& f = params.fill;
+    const wf::color_t& o = params.outline;
+    data.pass->custom_gles_subpass(data.target, [&]
+    {
+        if (!frame_compiled)
+        {
+            const std::string fragment = frame_fragment_source;
+            frame_program.set_simple(OpenGL::compile_program(deco_vertex_source, fragment));
+            frame_compiled = true;
+        }
+
+        wf::gles::bind_render_buffer(data.target);
+        frame_program.use(wf::TEXTURE_TYPE_RGBA);
+        frame_program.uniform4f("fill_color", glm::vec4(f.r * f.a, f.g * f.a, f.b * f.a, f.a));
+        frame_program.uniform4f("outline_color", glm::vec4(o.r * o.a, o.g * o.a, o.b * o.a, o.a));
+        frame_program.uniform4f("frame", glm::vec4(
+            params.frame.x, params.frame.y, params.frame.width, params.frame.height));
+        frame_program.uniform4f("content", glm::vec4(
+            params.content.x, params.content.y, params.content.width, params.content.height));
+        frame_program.uniform2f("radii", params.top_radius, params.bottom_radius);
+        draw_quad(data, frame_program, params.frame);
+    });
+}
+
+void decoration_shaders_t::fini()
+{
+    wf::gles::run_in_context_if_gles([&]
+    {
+        if (shadow_compiled)
+        {
+            shadow_program.free_resources();
+        }
+
+        if (frame_compiled)
+        {
+            frame_program.free_resources();
+        }
+    });
+
+    shadow_compiled = false;
+    frame_compiled  = false;
+}
+}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <wayfire/opengl.hpp>
+#include <wayfire/scene-render.hpp>
+
+namespace wf
+{
+namespace decor
+{
+/** Parameters of the analytic drop shadow */
+struct shadow_params_t
+{
+    /** The decoration outline which casts the shadow, in logical coordinates */
+    wf::geometry_t frame;
+    /** Corner radii of the outline */
+    double top_radius;
+    double bottom_radius;
+    /** Standard deviation of the Gaussian falloff, in logical pixels */
+    double radius;
+    /** Displacement of the shadow relative to the frame */
+    wf::pointf_t offset;
+    /** Non-premultiplied shadow color */
+    wf::color_t color;
+};
+
+/** Parameters of the shader-drawn frame */
+struct frame_params_t
+{
+    /** Outer edge of the decoration, in logical coordinates */
+    wf::geometry_t frame;
+    /** The client area, which is left unpainted */
+    wf::geometry_t content;
+    /** Corner radii of the outer edge */
+    double top_radius;
+    double bottom_radius;
+    /** Non-premultiplied fill color of titlebar and borders */
+    wf::color_t fill;
+    /** Non-premultiplied color of the 1px outline along the outer edge */
+    wf::color_t outline;
+};
+
+/**
+ * GLES programs shared by all decorations.
+ *
+ * The programs are compiled lazily on first use, inside the render pass, and
+ * must be freed with fini() before the plugin is unloaded.
+ */
+class decoration_shaders_t
+{
+  public:
+    static decoration_shaders_t& get();
+
+    /** @return Whether the current renderer can run the shaders */
+    static bool is_supported();
+
+    /** @return How far a shadow with the given parameters reaches beyond the frame */
+    static int get_shadow_extent(double radius, wf::pointf_t offset);
+
+    /**
+     * Draw a rounded-rect drop shadow with a Gaussian falloff.
+     * The cost is one draw call per damaged box, regardless of the window size.
+     */
+    void render_shadow(const wf::scene::render_instruction_t& data,
+        const shadow_params_t& params);
+
+    /**
+     * Draw titlebar, borders, rounded corners and outline of a solid-colored
+     * decoration in a single draw call per damaged box. Nothing is uploaded,
+     * so resizing costs no more than an unchanged frame.
+     */
+    void render_frame(const wf::scene::render_instruction_t& data,
+        const frame_params_t& params);
+
+    /** Free the GL resources of all compiled programs */
+    void fini();
+
+  private:
+    decoration_shaders_t() = default;
+
+    OpenGL::program_t shadow_program;
+    bool shadow_compiled = false;
+
+    OpenGL::program_t frame_program;
+    bool frame_compiled = false;
+
+    /** Draw a quad covering @box over each damaged box, with @program in use */
+    void draw_quad(const wf::scene::render_instruction_t& data,
+        OpenGL::program_t& program, wf::geometry_t box);
+};
+}
+}
@@ -0,0 +1,445 @@
+#include "deco-simd.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace wf
+{
+namespace decor
+{
+/*
+ * A box pass keeps one running sum per column and slides it down the image,
+ * so every row costs one add, one subtract and one scale over the row,
+ * independent of the radius. Sums fit 16 bits for radii up to 127, which
+ * lets the scale be a single high multiply by 65536 / (2 * radius + 1).
+ */
+struct row_ops_t
+{
+    const char *name;
+    void (*add)(uint16_t *sums, const uint8_t *row, int width);
+    void (*sub)(uint16_t *sums, const uint8_t *row, int width);
+    void (*scale)(uint8_t *row, const uint16_t *sums, uint16_t factor, int width);
+    /** One row of paint_alpha_mask() */
+    void (*paint)(uint32_t *row, const uint8_t *mask, uint32_t color, int width);
+};
+
+/** @return x / 255, rounded, for x <= 255 * 255 */
+static inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static void add_row_scalar(uint16_t *sums, const uint8_t *row, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        sums[x] += row[x];
+    }
+}
+
+static void sub_row_scalar(uint16_t *sums, const uint8_t *row, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        sums[x] -= row[x];
+    }
+}
+
+static void scale_row_scalar(uint8_t *row, const uint16_t *sums, uint16_t factor, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        row[x] = (uint32_t(sums[x]) * factor) >> 16;
+    }
+}
+
+static void paint_row_scalar(uint32_t *row, const uint8_t *mask, uint32_t color, int width)
+{
+    for (int x = 0; x < width; x++)
+    {
+        if (mask[x] == 0)
+        {
+            continue;
+        }
+
+        const uint32_t alpha = div255((color >> 24) * mask[x]);
+        uint32_t pixel = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            const uint32_t src = div255(((color >> shift) & 0xff) * mask[x]);
+            const uint32_t dst = (row[x] >> shift) & 0xff;
+            pixel |= (src + div255(dst * (255 - alpha))) << shift;
+        }
+
+        row[x] = pixel;
+    }
+}
+
+#if defined(__SSE2__)
+/** x / 255 in each 16-bit lane, for x <= 255 * 255 */
+static inline __m128i div255_epu16(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/** OVER for two pixels, one channel per 16-bit lane */
+static inline __m128i paint_pixels_sse2(__m128i dst, __m128i mask, __m128i color)
+{
+    const __m128i src   = div255_epu16(_mm_mullo_epi16(color, mask));
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src,
+        _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return _mm_add_epi16(src, div255_epu16(_mm_mullo_epi16(dst, inverse)));
+}
+
+static void paint_row_sse2(uint32_t *row, const uint8_t *mask, uint32_t color, int width)
+{
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i color2 = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        uint32_t coverage;
+        std::memcpy(&coverage, mask + x, 4);
+        if (coverage == 0)
+        {
+            continue;
+        }
+
+        /* Every mask byte repeated for the four channels of its pixel */
+        __m128i m = _mm_cvtsi32_si128(coverage);
+        m = _mm_unpacklo_epi8(m, m);
+        m = _mm_unpacklo_epi16(m, m);
+
+        __m128i *dst = reinterpret_cast<__m128i*>(row + x);
+        const __m128i pixels = _mm_loadu_si128(dst);
+        const __m128i low    = paint_pixels_sse2(_mm_unpacklo_epi8(pixels, zero),
+            _mm_unpacklo_epi8(m, zero), color2);
+        const __m128i high   = paint_pixels_sse2(_mm_unpackhi_epi8(pixels, zero),
+            _mm_unpackhi_epi8(m, zero), color2);
+        _mm_storeu_si128(dst, _mm_packus_epi16(low, high));
+    }
+
+    paint_row_scalar(row + x, mask + x, color, width - x);
+}
+
+static void add_row_sse2(uint16_t *sums, const uint8_t *row, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i pixels = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x)), zero);
+        __m128i *dst = reinterpret_cast<__m128i*>(sums + x);
+        _mm_storeu_si128(dst, _mm_add_epi16(_mm_loadu_si128(dst), pixels));
+    }
+
+    add_row_scalar(sums + x, row + x, width - x);
+}
+
+static void sub_row_sse2(uint16_t *sums, const uint8_t *row, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i pixels = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x)), zero);
+        __m128i *dst = reinterpret_cast<__m128i*>(sums + x);
+        _mm_storeu_si128(dst, _mm_sub_epi16(_mm_loadu_si128(dst), pixels));
+    }
+
+    sub_row_scalar(sums + x, row + x, width - x);
+}
+
+static void scale_row_sse2(uint8_t *row, const uint16_t *sums, uint16_t factor, int width)
+{
+    const __m128i scale = _mm_set1_epi16(factor);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i value = _mm_mulhi_epu16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + x)), scale);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row + x), _mm_packus_epi16(value, value));
+    }
+
+    scale_row_scalar(row + x, sums + x, factor, width - x);
+}
+
+__attribute__((target("avx2")))
+static void add_row_avx2(uint16_t *sums, const uint8_t *row, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i pixels = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)));
+        __m256i *dst = reinterpret_cast<__m256i*>(sums + x);
+        _mm256_storeu_si256(dst, _mm256_add_epi16(_mm256_loadu_si256(dst), pixels));
+    }
+
+    add_row_sse2(sums + x, row + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static void sub_row_avx2(uint16_t *sums, const uint8_t *row, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i pixels = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)));
+        __m256i *dst = reinterpret_cast<__m256i*>(sums + x);
+        _mm256_storeu_si256(dst, _mm256_sub_epi16(_mm256_loadu_si256(dst), pixels));
+    }
+
+    sub_row_sse2(sums + x, row + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static void scale_row_avx2(uint8_t *row, const uint16_t *sums, uint16_t factor, int width)
+{
+    const __m256i scale = _mm256_set1_epi16(factor);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i value = _mm256_mulhi_epu16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + x)), scale);
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(value),
+            _mm256_extracti128_si256(value, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), packed);
+    }
+
+    scale_row_sse2(row + x, sums + x, factor, width - x);
+}
+
+#elif defined(__ARM_NEON)
+/** Exact x / 255 of a 16-bit product, narrowed to 8 bits */
+static inline uint8x8_t div255_neon(uint16x8_t x)
+{
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+static void paint_row_neon(uint32_t *row, const uint8_t *mask, uint32_t color, int width)
+{
+    /* Little-endian ARGB32 pixels are B, G, R, A in memory */
+    const uint8x8_t channel[4] = {
+        vdup_n_u8(color & 0xff), vdup_n_u8((color >> 8) & 0xff),
+        vdup_n_u8((color >> 16) & 0xff), vdup_n_u8(color >> 24),
+    };
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint8x8_t m = vld1_u8(mask + x);
+        uint8_t *bytes    = reinterpret_cast<uint8_t*>(row + x);
+        uint8x8x4_t pixels = vld4_u8(bytes);
+
+        const uint8x8_t alpha   = div255_neon(vmull_u8(channel[3], m));
+        const uint8x8_t inverse = vmvn_u8(alpha);
+        for (int c = 0; c < 4; c++)
+        {
+            const uint8x8_t src = div255_neon(vmull_u8(channel[c], m));
+            pixels.val[c] = vadd_u8(src, div255_neon(vmull_u8(pixels.val[c], inverse)));
+        }
+
+        vst4_u8(bytes, pixels);
+    }
+
+    paint_row_scalar(row + x, mask + x, color, width - x);
+}
+
+static void add_row_neon(uint16_t *sums, const uint8_t *row, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        vst1q_u16(sums + x, vaddq_u16(vld1q_u16(sums + x), vmovl_u8(vld1_u8(row + x))));
+    }
+
+    add_row_scalar(sums + x, row + x, width - x);
+}
+
+static void sub_row_neon(uint16_t *sums, const uint8_t *row, int width)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        vst1q_u16(sums + x, vsubq_u16(vld1q_u16(sums + x), vmovl_u8(vld1_u8(row + x))));
+    }
+
+    sub_row_scalar(sums + x, row + x, width - x);
+}
+
+static void scale_row_neon(uint8_t *row, const uint16_t *sums, uint16_t factor, int width)
+{
+    const uint16x4_t scale = vdup_n_u16(factor);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        uint16x8_t value = vld1q_u16(sums + x);
+        uint16x4_t low   = vshrn_n_u32(vmull_u16(vget_low_u16(value), scale), 16);
+        uint16x4_t high  = vshrn_n_u32(vmull_u16(vget_high_u16(value), scale), 16);
+        vst1_u8(row + x, vmovn_u16(vcombine_u16(low, high)));
+    }
+
+    scale_row_scalar(row + x, sums + x, factor, width - x);
+}
+#endif
+
+/** Every kernel set this build and CPU can run, the fastest first */
+static std::vector<row_ops_t> get_supported_row_ops()
+{
+    std::vector<row_ops_t> supported;
+#if defined(__SSE2__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        supported.push_back({"avx2", add_row_avx2, sub_row_avx2, scale_row_avx2,
+            paint_row_sse2});
+    }
+
+    supported.push_back({"sse2", add_row_sse2, sub_row_sse2, scale_row_sse2, paint_row_sse2});
+#elif defined(__ARM_NEON)
+    supported.push_back({"neon", add_row_neon, sub_row_neon, scale_row_neon, paint_row_neon});
+#endif
+    supported.push_back({"scalar", add_row_scalar, sub_row_scalar, scale_row_scalar,
+        paint_row_scalar});
+    return supported;
+}
+
+static row_ops_t& get_row_ops()
+{
+    static row_ops_t ops = get_supported_row_ops().front();
+    return ops;
+}
+
+const char *get_simd_name()
+{
+    return get_row_ops().name;
+}
+
+std::vector<std::string> get_supported_simd_names()
+{
+    std::vector<std::string> names;
+    for (const auto& ops : get_supported_row_ops())
+    {
+        names.push_back(ops.name);
+    }
+
+    return names;
+}
+
+bool use_simd(const std::string& name)
+{
+    for (const auto& ops : get_supported_row_ops())
+    {
+        if (name == ops.name)
+        {
+            get_row_ops() = ops;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** One vertical box pass from @src to @dst, both tightly packed */
+static void box_pass_columns(const uint8_t *src, uint8_t *dst, int width, int height,
+    int radius, uint16_t *sums)
+{
+    const auto& ops = get_row_ops();
+    const uint16_t factor = (65536 + radius) / (2 * radius + 1);
+
+    std::fill(sums, sums + width, 0);
+    for (int y = 0; y < std::min(radius, height); y++)
+    {
+        ops.add(sums, src + size_t(y) * width, width);
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        if (y + radius < height)
+        {
+            ops.add(sums, src + size_t(y + radius) * width, width);
+        }
+
+        ops.scale(dst + size_t(y) * width, sums, factor, width);
+        if (y - radius >= 0)
+        {
+            ops.sub(sums, src + size_t(y - radius) * width, width);
+        }
+    }
+}
+
+/** Three vertical passes on a packed image, ending in @pixels again */
+static void blur_columns(std::vector<uint8_t>& pixels, std::vector<uint8_t>& scratch,
+    int width, int height, int radius, uint16_t *sums)
+{
+    box_pass_columns(pixels.data(), scratch.data(), width, height, radius, sums);
+    box_pass_columns(scratch.data(), pixels.data(), width, height, radius, sums);
+    box_pass_columns(pixels.data(), scratch.data(), width, height, radius, sums);
+    pixels.swap(scratch);
+}
+
+void blur_alpha_mask(uint8_t *pixels, int width, int height, int stride, int radius)
+{
+    radius = std::min(radius, MAX_BLUR_RADIUS);
+    if ((radius <= 0) || (width <= 0) || (height <= 0))
+    {
+        return;
+    }
+
+    /* Rows are blurred as the columns of the transposed image, so both
+     * directions use the same vectorized column pass. */
+    std::vector<uint8_t> image(size_t(width) * height);
+    std::vector<uint8_t> scratch(image.size());
+    std::vector<uint16_t> sums(std::max(width, height));
+    for (int y = 0; y < height; y++)
+    {
+        std::memcpy(&image[size_t(y) * width], pixels + size_t(y) * stride, width);
+    }
+
+    blur_columns(image, scratch, width, height, radius, sums.data());
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            scratch[size_t(x) * height + y] = image[size_t(y) * width + x];
+        }
+    }
+
+    image.swap(scratch);
+    blur_columns(image, scratch, height, width, radius, sums.data());
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            pixels[size_t(y) * stride + x] = image[size_t(x) * height + y];
+        }
+    }
+}
+
+void paint_alpha_mask(uint8_t *dst, int dst_stride, const uint8_t *mask, int mask_stride,
+    int width, int height, uint32_t color)
+{
+    const auto& ops = get_row_ops();
+    for (int y = 0; y < height; y++)
+    {
+        ops.paint(reinterpret_cast<uint32_t*>(dst + size_t(y) * dst_stride),
+            mask + size_t(y) * mask_stride, color, width);
+    }
+}
+}
+}
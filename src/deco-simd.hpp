@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/** Largest radius blur_alpha_mask() accepts; larger ones are clamped */
+static constexpr int MAX_BLUR_RADIUS = 127;
+
+/**
+ * Blur an A8 image in place with three box passes of @radius in each
+ * direction, which approximates a Gaussian with a standard deviation of
+ * about @radius. Pixels outside the image count as transparent.
+ *
+ * Uses AVX2, SSE2 or NEON where available, otherwise plain C++.
+ */
+void blur_alpha_mask(uint8_t *pixels, int width, int height, int stride, int radius);
+
+/**
+ * Paint @color through an A8 mask onto an ARGB32 image, like cairo_mask()
+ * with the OVER operator. Both images are @width x @height.
+ *
+ * @param color Premultiplied, as a cairo ARGB32 pixel
+ */
+void paint_alpha_mask(uint8_t *dst, int dst_stride, const uint8_t *mask, int mask_stride,
+    int width, int height, uint32_t color);
+
+/** @return The instruction set the kernels run on, for logging */
+const char *get_simd_name();
+
+/** @return The instruction sets this build and CPU can run, the fastest first */
+std::vector<std::string> get_supported_simd_names();
+
+/**
+ * Run the kernels on instruction set @name from get_supported_simd_names()
+ * instead of the fastest, e.g. to compare them in the tests. Not thread safe.
+ *
+ * @return false, changing nothing, if @name is not supported
+ */
+bool use_simd(const std::string& name);
+}
+}
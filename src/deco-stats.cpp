@@ -0,0 +1,136 @@
+#include "deco-stats.hpp"
+#include <algorithm>
+
+namespace wf
+{
+namespace decor
+{
+static const char *counter_names[STAT_COUNTER_COUNT] = {
+    "background-hits",
+    "background-misses",
+    "title-renders",
+    "button-renders",
+    "finder-stat-calls",
+    "theme-loads",
+    "theme-reloads",
+    "title-cache-hits",
+    "title-cache-misses",
+    "svg-parses",
+    "background-part-renders",
+    "finder-cache-hits",
+    "glyph-rasterizations",
+    "texture-reuses",
+    "glyph-atlas-overflows",
+};
+
+static const char *timer_names[TIMER_COUNT] = {
+    "theme-load",
+    "background-miss",
+    "title-render",
+    "button-render",
+};
+
+void duration_histogram_t::add(uint64_t us)
+{
+    int bucket = 0;
+    while ((bucket < BUCKETS - 1) && (us >= (uint64_t(1) << bucket)))
+    {
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    count++;
+    total_us += us;
+    max_us    = std::max(max_us, us);
+}
+
+wf::json_t duration_histogram_t::to_json() const
+{
+    wf::json_t histogram;
+    histogram["count"]    = (int64_t)count;
+    histogram["total-us"] = (int64_t)total_us;
+    histogram["max-us"]   = (int64_t)max_us;
+    histogram["mean-us"]  = count ? (double)total_us / count : 0.0;
+
+    /* Only non-empty buckets, as [upper bound in us, count] pairs */
+    wf::json_t list = wf::json_t::array();
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        if (buckets[i] > 0)
+        {
+            wf::json_t bucket = wf::json_t::array();
+            bucket.append((int64_t)(uint64_t(1) << i));
+            bucket.append((int64_t)buckets[i]);
+            list.append(bucket);
+        }
+    }
+
+    histogram["buckets"] = list;
+    return histogram;
+}
+
+decoration_stats_t& decoration_stats_t::global()
+{
+    static decoration_stats_t stats;
+    return stats;
+}
+
+void decoration_stats_t::count(stat_counter_t counter, uint64_t amount)
+{
+    counters[counter] += amount;
+    if (this != &global())
+    {
+        global().counters[counter] += amount;
+    }
+}
+
+void decoration_stats_t::record(stat_timer_t timer, uint64_t us)
+{
+    timers[timer].add(us);
+    if (this != &global())
+    {
+        global().timers[timer].add(us);
+    }
+}
+
+void decoration_stats_t::reset()
+{
+    *this = decoration_stats_t{};
+}
+
+wf::json_t decoration_stats_t::to_json() const
+{
+    wf::json_t stats;
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+    {
+        stats[counter_names[i]] = (int64_t)counters[i];
+    }
+
+    const uint64_t lookups = counters[STAT_BACKGROUND_HIT] + counters[STAT_BACKGROUND_MISS];
+    stats["background-hit-rate"] = lookups ? (double)counters[STAT_BACKGROUND_HIT] / lookups : 0.0;
+    const uint64_t title_lookups = counters[STAT_TITLE_CACHE_HIT] + counters[STAT_TITLE_CACHE_MISS];
+    stats["title-cache-hit-rate"] = title_lookups ?
+        (double)counters[STAT_TITLE_CACHE_HIT] / title_lookups : 0.0;
+
+    wf::json_t durations;
+    for (int i = 0; i < TIMER_COUNT; i++)
+    {
+        durations[timer_names[i]] = timers[i].to_json();
+    }
+
+    stats["durations"] = durations;
+    return stats;
+}
+
+stat_timer_scope_t::stat_timer_scope_t(decoration_stats_t& stats, stat_timer_t timer) :
+    stats(stats), timer(timer), start(std::chrono::steady_clock::now())
+{}
+
+stat_timer_scope_t::~stat_timer_scope_t()
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    stats.record(timer,
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <wayfire/nonstd/json.hpp>
+#include <chrono>
+#include <cstdint>
+
+namespace wf
+{
+namespace decor
+{
+/** Events counted by the decorations */
+enum stat_counter_t
+{
+    STAT_BACKGROUND_HIT         = 0,
+    STAT_BACKGROUND_MISS        = 1,
+    STAT_TITLE_RENDER           = 2,
+    STAT_BUTTON_RENDER          = 3,
+    STAT_FINDER_STAT            = 4,
+    STAT_THEME_LOAD             = 5,
+    STAT_THEME_RELOAD           = 6,
+    STAT_TITLE_CACHE_HIT        = 7,
+    STAT_TITLE_CACHE_MISS       = 8,
+    STAT_SVG_PARSE              = 9,
+    STAT_BACKGROUND_PART_RENDER = 10,
+    STAT_FINDER_CACHE_HIT       = 11,
+    STAT_GLYPH_RASTER           = 12,
+    STAT_TEXTURE_REUSE          = 13,
+    STAT_GLYPH_ATLAS_OVERFLOW   = 14,
+    STAT_COUNTER_COUNT          = 15,
+};
+
+/** Operations whose duration is recorded */
+enum stat_timer_t
+{
+    TIMER_THEME_LOAD      = 0,
+    TIMER_BACKGROUND_MISS = 1,
+    TIMER_TITLE_RENDER    = 2,
+    TIMER_BUTTON_RENDER   = 3,
+    TIMER_COUNT = 4,
+};
+
+/** Durations in power-of-two microsecond buckets: <1us, <2us, <4us, ... */
+struct duration_histogram_t
+{
+    static constexpr int BUCKETS = 24;
+    uint64_t buckets[BUCKETS] = {};
+    uint64_t count    = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us   = 0;
+
+    void add(uint64_t us);
+    wf::json_t to_json() const;
+};
+
+/**
+ * Counters and duration histograms for one decoration. Every update is also
+ * applied to the global instance, so the totals survive closed windows.
+ */
+struct decoration_stats_t
+{
+    uint64_t counters[STAT_COUNTER_COUNT] = {};
+    duration_histogram_t timers[TIMER_COUNT];
+
+    /** @return Statistics summed over all decorations since the last reset */
+    static decoration_stats_t& global();
+
+    void count(stat_counter_t counter, uint64_t amount = 1);
+    void record(stat_timer_t timer, uint64_t us);
+    void reset();
+    wf::json_t to_json() const;
+};
+
+/** Records the time between its construction and destruction */
+class stat_timer_scope_t
+{
+  public:
+    stat_timer_scope_t(decoration_stats_t& stats, stat_timer_t timer);
+    ~stat_timer_scope_t();
+    stat_timer_scope_t(const stat_timer_scope_t&) = delete;
+    stat_timer_scope_t& operator =(const stat_timer_scope_t&) = delete;
+
+  private:
+    decoration_stats_t& stats;
+    stat_timer_t timer;
+    std::chrono::steady_clock::time_point start;
+};
+}
+}
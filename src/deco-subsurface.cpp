@@ -19,27 +19,111 @@
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/toplevel-view.hpp>
 #include "deco-subsurface.hpp"
+#include "deco-arena.hpp"
 #include "deco-layout.hpp"
 #include "deco-theme.hpp"
+#include "deco-glyphs.hpp"
+#include "deco-textures.hpp"
+#include "deco-trace.hpp"
 #include <wayfire/window-manager.hpp>
+#include <wayfire/util.hpp>
 
 #include <wayfire/plugins/common/cairo-util.hpp>
 
 #include <cairo.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <map>
 
 class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_interaction_t,
     public wf::touch_interaction_t
 {
+    /**
+     * Declared first, so it is destroyed after every member holding cached
+     * textures. Anything still charged to the node's token by then, or any
+     * shared title or theme pixmap handed out to it and still referenced
+     * elsewhere, has leaked.
+     */
+    struct leak_check_t
+    {
+        /** Owns this node's cache entries; never reused, unlike view ids */
+        uint64_t token;
+
+        leak_check_t()
+        {
+            static uint64_t next_token = 1;
+            token = next_token++;
+        }
+
+        ~leak_check_t()
+        {
+            const bool released =
+                wf::decor::texture_budget_t::get().check_owner_released(token);
+#ifndef NDEBUG
+            assert(released && "decoration textures outlive their decoration");
+#endif
+            (void)released;
+        }
+    } leak_check;
+
     std::weak_ptr<wf::toplevel_view_interface_t> _view;
     wf::signal::connection_t<wf::view_title_changed_signal> title_set =
         [=] (wf::view_title_changed_signal *ev)
     {
+        /* A pending deferred update will pick up the latest title anyway */
+        if (title_timer.is_connected())
+        {
+            return;
+        }
+
         if (auto view = _view.lock())
         {
             view->damage();
         }
     };
 
+    wf::option_wrapper_t<int> title_update_rate{"gtkdecor/title_update_rate"};
+    wf::wl_timer<false> title_timer;
+    std::chrono::steady_clock::time_point last_title_update;
+
+    /**
+     * Whether a title change has to wait because the title was re-rendered
+     * less than 1/title_update_rate seconds ago. If so, a redraw is scheduled
+     * for when the interval is over, so the latest title is always shown.
+     */
+    bool defer_title_update()
+    {
+        const int rate = title_update_rate;
+        if (rate <= 0)
+        {
+            return false;
+        }
+
+        const auto interval = std::chrono::milliseconds(1000 / rate);
+        const auto elapsed  = std::chrono::steady_clock::now() - last_title_update;
+        if (elapsed >= interval)
+        {
+            return false;
+        }
+
+        if (!title_timer.is_connected())
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                interval - elapsed).count();
+            title_timer.set_timeout(std::max<int64_t>(remaining, 1), [=] ()
+            {
+                if (auto view = _view.lock())
+                {
+                    view->damage();
+                }
+            });
+        }
+
+        return true;
+    }
+
     void update_title(int width, int height, double scale)
     {
         if (auto view = _view.lock())
@@ -49,24 +133,205 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
                 static_cast<int32_t>(height * scale)
             };
 
-            if ((title_texture.tex.get_size() != target_size) ||
-                (title_texture.current_text != view->get_title()))
+            const bool resized = !title_texture.tex || (title_texture.size != target_size);
+            if (!resized && (title_texture.current_text == view->get_title()))
             {
-                int btn_w = static_cast<int>(layout.get_button_area_width() * scale);
-                auto surface = theme.render_text(view->get_title(), target_size.width, target_size.height, btn_w);
-                title_texture.tex = wf::owned_texture_t{surface};
-                cairo_surface_destroy(surface);
+                /* Changed back before a newer title was done, e.g. A, B, A:
+                 * B must not replace A when it arrives */
+                title_texture.pending = false;
+                return;
+            }
+
+            /* A new text is already being rendered; it will damage the title */
+            if (!resized && title_texture.pending &&
+                (title_texture.pending_text == view->get_title()))
+            {
+                return;
+            }
+
+            /* Resizes are never deferred, a stretched title would look broken */
+            if (!resized && defer_title_update())
+            {
+                return;
+            }
+
+            int btn_w = static_cast<int>(layout.get_button_area_width() * scale);
+            last_title_update = std::chrono::steady_clock::now();
+            if (resized)
+            {
+                title_texture.tex = theme.get_title_texture(view->get_title(),
+                    target_size.width, target_size.height, btn_w);
+                title_texture.size = target_size;
                 title_texture.current_text = view->get_title();
+                title_texture.pending = false;
+                return;
+            }
+
+            /* Only the text changed: keep showing the old title until the
+             * worker has rendered the new one. Pending before the call, since
+             * without a worker thread the title is done before it returns. */
+            std::weak_ptr<wf::scene::node_t> weak_self = weak_from_this();
+            const std::string title = view->get_title();
+            title_texture.pending = true;
+            title_texture.pending_text = title;
+            auto tex = theme.get_title_texture_async(title, target_size.width,
+                target_size.height, btn_w, [weak_self, title, target_size] (auto tex)
+            {
+                if (auto self = weak_self.lock())
+                {
+                    std::static_pointer_cast<simple_decoration_node_t>(self)->
+                    on_title_rendered(title, target_size, tex);
+                }
+            });
+
+            if (tex)
+            {
+                title_texture.pending = false;
+                title_texture.tex = tex;
+                title_texture.current_text = title;
             }
         }
     }
 
+    /**
+     * Show a title finished by the worker, unless it has been superseded by
+     * a newer title, a resize or a theme reload in the meantime.
+     */
+    void on_title_rendered(const std::string& text, wf::dimensions_t size,
+        std::shared_ptr<wf::owned_texture_t> tex)
+    {
+        if (!title_texture.pending || (title_texture.pending_text != text))
+        {
+            return;
+        }
+
+        title_texture.pending = false;
+        if (title_texture.size != size)
+        {
+            return;
+        }
+
+        title_texture.tex = tex;
+        title_texture.current_text = text;
+        wf::scene::damage_node(shared_from_this(), title_texture.geometry);
+    }
+
     struct
     {
-        wf::owned_texture_t tex;
+        /* Shared with the title cache, which accounts for its memory */
+        std::shared_ptr<wf::owned_texture_t> tex;
+        wf::dimensions_t size = {0, 0};
         std::string current_text = "";
+        /* Where the title was last drawn, in node coordinates */
+        wf::geometry_t geometry = {0, 0, 0, 0};
+        /* Whether pending_text is being rendered by the worker */
+        bool pending = false;
+        std::string pending_text = "";
     } title_texture;
 
+    /* The title as quads into the shared glyph atlas, when it is used */
+    wf::decor::glyph_run_t title_glyphs;
+
+    /**
+     * All buttons in their resting state, composed into one texture so an
+     * idle decoration submits a single draw for them instead of one each.
+     */
+    struct button_strip_t
+    {
+        std::unique_ptr<wf::owned_texture_t> tex;
+        /* Union of the button geometries, relative to the layout */
+        wf::geometry_t geometry{};
+        bool activated = false;
+        bool valid     = false;
+        wf::decor::cache_entry_t entry{wf::decor::CACHE_BUTTON, [this] ()
+            {
+                tex.reset();
+                valid = false;
+            }
+        };
+    };
+
+    /**
+     * One strip per output scale, so a view spanning outputs of different
+     * scales does not redraw its strip for every output in every frame.
+     */
+    std::map<double, std::unique_ptr<button_strip_t>> button_strips;
+
+    /** @return The strip for @scale, dropping those of outputs which are gone */
+    button_strip_t& get_button_strip(double scale)
+    {
+        auto it = button_strips.find(scale);
+        if (it != button_strips.end())
+        {
+            return *it->second;
+        }
+
+        const auto& scales = wf::decor::decoration_theme_t::get_output_scales();
+        for (auto strip = button_strips.begin(); strip != button_strips.end();)
+        {
+            if (std::find(scales.begin(), scales.end(), strip->first) == scales.end())
+            {
+                strip = button_strips.erase(strip);
+            } else
+            {
+                ++strip;
+            }
+        }
+
+        auto& strip = button_strips[scale];
+        strip = std::make_unique<button_strip_t>();
+        strip->entry.set_owner(leak_check.token);
+        return *strip;
+    }
+
+    /** @return The strip of the resting buttons at @scale, redrawn if outdated */
+    button_strip_t& update_button_strip(
+        const std::vector<nonstd::observer_ptr<wf::decor::decoration_area_t>>& buttons,
+        bool activated, double scale)
+    {
+        wf::geometry_t bounds = buttons.front()->get_geometry();
+        for (auto& button : buttons)
+        {
+            auto g = button->get_geometry();
+            double x2 = std::max(bounds.x + bounds.width, g.x + g.width);
+            double y2 = std::max(bounds.y + bounds.height, g.y + g.height);
+            bounds.x = std::min(bounds.x, g.x);
+            bounds.y = std::min(bounds.y, g.y);
+            bounds.width  = x2 - bounds.x;
+            bounds.height = y2 - bounds.y;
+        }
+
+        auto& strip = get_button_strip(scale);
+        if (strip.valid && (strip.geometry == bounds) && (strip.activated == activated))
+        {
+            strip.entry.touch();
+            return strip;
+        }
+
+        const int width  = std::ceil(bounds.width * scale);
+        const int height = std::ceil(bounds.height * scale);
+        auto surface = wf::decor::surface_arena_t::get().create(CAIRO_FORMAT_ARGB32,
+            width, height);
+        auto cr = cairo_create(surface);
+        cairo_scale(cr, scale, scale);
+        for (auto& button : buttons)
+        {
+            auto g = button->get_geometry();
+            button->as_button().paint_at_rest(cr, {g.x - bounds.x, g.y - bounds.y, g.width, g.height},
+                scale);
+        }
+
+        cairo_destroy(cr);
+        wf::decor::texture_pool_t::get().upload(strip.tex, surface);
+        cairo_surface_destroy(surface);
+
+        strip.geometry  = bounds;
+        strip.activated = activated;
+        strip.valid     = true;
+        strip.entry.charge(static_cast<size_t>(width) * height * 4);
+        return strip;
+    }
+
   public:
     wf::decor::decoration_theme_t theme;
     wf::decor::decoration_layout_t layout;
@@ -87,6 +352,7 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
     {
         LOGI("Creating decoration for view: ", view->get_title());
         this->_view = view->weak_from_this();
+        theme.set_owner(leak_check.token);
         view->connect(&title_set);
         if (view->parent)
         {
@@ -109,6 +375,7 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
 
     void render(const wf::scene::render_instruction_t& data)
     {
+        DECO_TRACE_SPAN("decoration render");
         auto origin = get_offset();
         /* Clear background */
         wf::geometry_t geometry{origin.x, origin.y,
@@ -123,26 +390,74 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         theme.render_background(data, geometry, activated);
 
         /* Draw title & buttons */
-        auto renderables = layout.get_renderable_areas();
-        for (auto item : renderables)
+        std::vector<nonstd::observer_ptr<wf::decor::decoration_area_t>> buttons;
+        bool buttons_at_rest = true;
+        for (auto item : layout.get_renderable_areas())
         {
             if (item->get_type() == wf::decor::DECORATION_AREA_TITLE)
             {
                 wf::geometry_t title_geometry = item->get_geometry() + origin;
+                title_texture.geometry = title_geometry;
+                if (theme.use_glyph_atlas())
+                {
+                    auto view = _view.lock();
+                    if (!view || theme.render_title_glyphs(data, title_glyphs,
+                        view->get_title(), title_geometry, layout.get_button_area_width()))
+                    {
+                        title_texture.tex = nullptr;
+                        continue;
+                    }
+
+                    /* Too large for the atlas, drawn from a texture instead */
+                } else
+                {
+                    title_glyphs = {};
+                }
+
                 update_title(title_geometry.width, title_geometry.height, data.target.scale);
-                if (title_texture.tex.get_texture() != NULL)
+                if (title_texture.tex && (title_texture.tex->get_texture() != NULL))
                 {
-                    data.pass->add_texture(title_texture.tex.get_texture(), data.target,
+                    data.pass->add_texture(title_texture.tex->get_texture(), data.target,
                         title_geometry, data.damage);
                 }
             } else // button
             {
                 item->as_button().set_activated(activated);
-                item->as_button().render(data, item->get_geometry() + origin);
+                buttons_at_rest &= item->as_button().is_at_rest();
+                buttons.push_back(item);
+            }
+        }
+
+        if (buttons.empty())
+        {
+            return;
+        }
+
+        /* Resting buttons share one draw; while any of them is hovered,
+         * pressed or animating, they are drawn one by one. */
+        if (buttons_at_rest)
+        {
+            auto& strip = update_button_strip(buttons, activated, data.target.scale);
+            data.pass->add_texture(strip.tex->get_texture(), data.target,
+                strip.geometry + origin, data.damage);
+        } else
+        {
+            for (auto& button : buttons)
+            {
+                button->as_button().render(data, button->get_geometry() + origin);
             }
         }
     }
 
+    void reload_theme()
+    {
+        theme.reload_theme();
+        title_texture.tex = nullptr;
+        title_texture.pending = false;
+        title_timer.disconnect();
+        button_strips.clear();
+    }
+
     std::optional<wf::scene::input_node_t> find_node_at(const wf::pointf_t& at) override
     {
         if (auto view = _view.lock())
@@ -218,7 +533,10 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
 
     wf::geometry_t get_bounding_box() override
     {
-        return wf::construct_box(get_offset(), size);
+        /* Include the drop shadow, so that damage covering it reaches us */
+        const int shadow = theme.get_shadow_extent();
+        return wf::construct_box(get_offset() - wf::pointf_t{(double)shadow, (double)shadow},
+            {size.width + 2 * shadow, size.height + 2 * shadow});
     }
 
     /* wf::compositor_surface_t implementation */
@@ -335,6 +653,12 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
             this->cached_region = layout.calculate_region();
         }
     }
+
+    /** @return The owner of this decoration's cache entries, see set_owner() */
+    uint64_t get_owner_token() const
+    {
+        return leak_check.token;
+    }
 };
 
 wf::simple_decorator_t::simple_decorator_t(wayfire_toplevel_view view) :
@@ -392,5 +716,15 @@ wf::decoration_margins_t wf::simple_decorator_t::get_margins(const wf::toplevel_
 
 void wf::simple_decorator_t::reload_theme()
 {
-    deco->theme.reload_theme();
+    deco->reload_theme();
+}
+
+wf::decor::decoration_stats_t& wf::simple_decorator_t::get_stats()
+{
+    return deco->theme.get_stats();
+}
+
+uint64_t wf::simple_decorator_t::get_owner_token() const
+{
+    return deco->get_owner_token();
 }
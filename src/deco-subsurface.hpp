@@ -5,6 +5,7 @@
 #include "wayfire/toplevel.hpp"
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/toplevel-view.hpp>
+#include "deco-stats.hpp"
 
 class simple_decoration_node_t;
 namespace wf
@@ -26,6 +27,10 @@ class simple_decorator_t : public wf::custom_data_t
     ~simple_decorator_t();
     wf::decoration_margins_t get_margins(const wf::toplevel_state_t& state);
     void reload_theme();
+    /** @return Rendering statistics of this view's decoration */
+    wf::decor::decoration_stats_t& get_stats();
+    /** @return The owner its cache entries are charged to, see gtkdecor/memory */
+    uint64_t get_owner_token() const;
 };
 }
 
@@ -0,0 +1,126 @@
+#ifdef HAVE_LIBRSVG
+#include "deco-svg.hpp"
+#include "deco-stats.hpp"
+#include "deco-trace.hpp"
+#include <wayfire/debug.hpp>
+#include <gio/gio.h>
+
+namespace wf
+{
+namespace decor
+{
+svg_document_cache_t& svg_document_cache_t::get()
+{
+    static svg_document_cache_t cache;
+    return cache;
+}
+
+RsvgHandle*svg_document_cache_t::get_handle(const std::string& path)
+{
+    auto it = documents.find(path);
+    if (it != documents.end())
+    {
+        if (it->second.entry)
+        {
+            it->second.entry->touch();
+        }
+
+        return it->second.handle;
+    }
+
+    size_t length = 0;
+    std::string error;
+    RsvgHandle *handle = load(path, length, error);
+    if (!handle)
+    {
+        LOGE("Failed to load SVG ", path, ": ", error);
+    }
+
+    insert(path, handle, length);
+    return handle;
+}
+
+bool svg_document_cache_t::contains(const std::string& path) const
+{
+    return documents.count(path) > 0;
+}
+
+RsvgHandle*svg_document_cache_t::load(const std::string& path, size_t& length,
+    std::string& error)
+{
+    DECO_TRACE_SPAN("parse_svg");
+
+    /* Read the file in one go and parse from memory. The file is still
+     * passed as the base, so relative references resolve as before. */
+    gchar *contents = nullptr;
+    gsize size = 0;
+    GError *gerror = nullptr;
+    RsvgHandle *handle = nullptr;
+    if (g_file_get_contents(path.c_str(), &contents, &size, &gerror))
+    {
+        GBytes *bytes = g_bytes_new_take(contents, size);
+        GInputStream *stream = g_memory_input_stream_new_from_bytes(bytes);
+        GFile *base = g_file_new_for_path(path.c_str());
+        handle = rsvg_handle_new_from_stream_sync(stream, base, RSVG_HANDLE_FLAGS_NONE,
+            nullptr, &gerror);
+        g_object_unref(base);
+        g_object_unref(stream);
+        g_bytes_unref(bytes);
+    }
+
+    if (gerror)
+    {
+        error = gerror->message;
+        g_error_free(gerror);
+    }
+
+    length = size;
+    return handle;
+}
+
+void svg_document_cache_t::insert(const std::string& path, RsvgHandle *handle, size_t length)
+{
+    erase(path);
+    decoration_stats_t::global().count(STAT_SVG_PARSE);
+
+    auto& document = documents[path];
+    document.handle = handle;
+    if (handle)
+    {
+        document.entry = std::make_unique<cache_entry_t>(CACHE_SVG_DOCUMENT, [this, path] ()
+        {
+            erase(path);
+        });
+        document.entry->charge(length);
+    }
+}
+
+void svg_document_cache_t::erase(const std::string& path)
+{
+    auto it = documents.find(path);
+    if (it != documents.end())
+    {
+        if (it->second.handle)
+        {
+            g_object_unref(it->second.handle);
+        }
+
+        documents.erase(it);
+    }
+}
+
+void svg_document_cache_t::clear()
+{
+    for (auto& [path, document] : documents)
+    {
+        if (document.handle)
+        {
+            g_object_unref(document.handle);
+        }
+    }
+
+    documents.clear();
+}
+}
+}
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+#ifdef HAVE_LIBRSVG
+#include "deco-cache.hpp"
+#include <librsvg/rsvg.h>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * Parsed SVG documents shared by all decorations, keyed by path.
+ *
+ * Parsing builds the whole SVG DOM, which costs far more than rendering a
+ * small icon, so each file is read and parsed once and then rendered at
+ * whatever size and scale is needed. The documents are accounted against the
+ * texture budget by the size of their file.
+ */
+class svg_document_cache_t
+{
+  public:
+    static svg_document_cache_t& get();
+
+    /**
+     * @return The parsed document at @path, or nullptr if it cannot be
+     *   loaded. The handle is owned by the cache and stays valid until the
+     *   next lookup or clear().
+     */
+    RsvgHandle *get_handle(const std::string& path);
+
+    /** @return Whether @path has been loaded (or failed to load) already */
+    bool contains(const std::string& path) const;
+
+    /**
+     * Read and parse the file at @path without touching the cache, so it can
+     * run on any thread.
+     *
+     * @param length Set to the size of the file
+     * @param error Set to the reason if loading fails
+     * @return A new handle, or nullptr on failure
+     */
+    static RsvgHandle *load(const std::string& path, size_t& length, std::string& error);
+
+    /** Add a document parsed with load(), taking ownership of @handle */
+    void insert(const std::string& path, RsvgHandle *handle, size_t length);
+
+    /** Drop all documents, e.g. because the theme changed on disk */
+    void clear();
+
+  private:
+    svg_document_cache_t() = default;
+
+    struct document_t
+    {
+        /** nullptr for files which failed to load */
+        RsvgHandle *handle = nullptr;
+        std::unique_ptr<cache_entry_t> entry;
+    };
+
+    std::map<std::string, document_t> documents;
+
+    void erase(const std::string& path);
+};
+}
+}
+#endif
@@ -0,0 +1,170 @@
+#include "deco-textures.hpp"
+#include "deco-stats.hpp"
+#include "deco-trace.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <GLES2/gl2ext.h>
+
+namespace wf
+{
+namespace decor
+{
+texture_pool_t& texture_pool_t::get()
+{
+    static texture_pool_t pool;
+    return pool;
+}
+
+static wf::dimensions_t get_surface_size(cairo_surface_t *surface)
+{
+    return {cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface)};
+}
+
+void texture_pool_t::upload(std::unique_ptr<wf::owned_texture_t>& texture,
+    cairo_surface_t *surface)
+{
+    const auto size = get_surface_size(surface);
+    if (texture && (texture->get_size() != size))
+    {
+        release(std::move(texture));
+    }
+
+    if (!texture)
+    {
+        texture = take(size);
+    }
+
+    if (!texture || !update_in_place(*texture, surface))
+    {
+        texture = std::make_unique<wf::owned_texture_t>(surface);
+    }
+}
+
+void texture_pool_t::upload(std::shared_ptr<wf::owned_texture_t>& texture,
+    cairo_surface_t *surface)
+{
+    if (texture && (texture.use_count() == 1) &&
+        (texture->get_size() == get_surface_size(surface)) &&
+        update_in_place(*texture, surface))
+    {
+        return;
+    }
+
+    texture = std::make_shared<wf::owned_texture_t>(surface);
+}
+
+void texture_pool_t::release(std::unique_ptr<wf::owned_texture_t> texture)
+{
+    if (!texture || !wf::get_core().is_gles2())
+    {
+        return;
+    }
+
+    pooled.push_back(std::move(texture));
+    if (pooled.size() > MAX_POOLED)
+    {
+        pooled.erase(pooled.begin());
+    }
+
+    charge();
+}
+
+std::unique_ptr<wf::owned_texture_t> texture_pool_t::take(wf::dimensions_t size)
+{
+    for (auto it = pooled.rbegin(); it != pooled.rend(); ++it)
+    {
+        if ((*it)->get_size() == size)
+        {
+            auto texture = std::move(*it);
+            pooled.erase(std::next(it).base());
+            charge();
+            return texture;
+        }
+    }
+
+    return nullptr;
+}
+
+bool texture_pool_t::update_in_place(wf::owned_texture_t& texture, cairo_surface_t *surface)
+{
+    wlr_texture *wlr_tex = texture.get_texture();
+    if (!wlr_tex || !wlr_texture_is_gles2(wlr_tex) ||
+        (cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32))
+    {
+        return false;
+    }
+
+    DECO_TRACE_SPAN("update_texture_in_place");
+    wlr_gles2_texture_attribs attribs;
+    wlr_gles2_texture_get_attribs(wlr_tex, &attribs);
+
+    cairo_surface_flush(surface);
+    const auto size  = get_surface_size(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    const uint8_t *data = cairo_image_surface_get_data(surface);
+
+    /* Padded rows need GL_UNPACK_ROW_LENGTH_EXT, which plain GLES2 lacks */
+    const bool packed = (stride == size.width * 4);
+    static const bool unpack_subimage =
+        wlr_gles2_renderer_check_ext(wf::get_core().renderer, "GL_EXT_unpack_subimage");
+    if (!packed && !unpack_subimage)
+    {
+        return false;
+    }
+
+    /* Same layout as the texture was created with: ARGB8888 is BGRA in
+     * memory, which the wlroots GLES renderer requires support for */
+    wf::gles::run_in_context_if_gles([&]
+    {
+        GL_CALL(glBindTexture(attribs.target, attribs.tex));
+        if (!packed)
+        {
+            GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride / 4));
+        }
+
+        GL_CALL(glTexSubImage2D(attribs.target, 0, 0, 0, size.width, size.height,
+            GL_BGRA_EXT, GL_UNSIGNED_BYTE, data));
+        if (!packed)
+        {
+            GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0));
+        }
+
+        GL_CALL(glBindTexture(attribs.target, 0));
+    });
+
+    decoration_stats_t::global().count(STAT_TEXTURE_REUSE);
+    return true;
+}
+
+void texture_pool_t::charge()
+{
+    if (!entry)
+    {
+        entry = std::make_unique<cache_entry_t>(CACHE_TEXTURE_POOL, [this] ()
+        {
+            pooled.clear();
+        });
+    }
+
+    size_t bytes = 0;
+    for (const auto& texture : pooled)
+    {
+        bytes += static_cast<size_t>(texture->get_size().width) * texture->get_size().height * 4;
+    }
+
+    if (bytes > 0)
+    {
+        entry->charge(bytes);
+    } else
+    {
+        entry->release();
+    }
+}
+
+void texture_pool_t::clear()
+{
+    pooled.clear();
+    entry.reset();
+}
+}
+}
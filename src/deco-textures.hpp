@@ -0,0 +1,62 @@
+#pragma once
+#include "deco-cache.hpp"
+#include <wayfire/opengl.hpp>
+#include <cairo.h>
+#include <memory>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * Reuses the GL storage of decoration textures whose image changes but not
+ * its size, e.g. a hovered button, a focus change or a frame part that was
+ * resized back and forth, by uploading the new pixels with glTexSubImage2D
+ * instead of allocating a new texture.
+ *
+ * A few textures dropped by their owners are kept for reuse, accounted
+ * against the texture budget. Without the GLES renderer, textures are
+ * simply recreated.
+ */
+class texture_pool_t
+{
+  public:
+    static texture_pool_t& get();
+
+    /**
+     * Make @texture show @surface, updating it in place if it has the same
+     * size, or else replacing it with a pooled or new texture.
+     */
+    void upload(std::unique_ptr<wf::owned_texture_t>& texture, cairo_surface_t *surface);
+
+    /**
+     * Like the above, but @texture is only updated in place if nobody else
+     * holds it, e.g. a theme pixmap shared with the asset cache.
+     */
+    void upload(std::shared_ptr<wf::owned_texture_t>& texture, cairo_surface_t *surface);
+
+    /** Keep a texture which is no longer needed for reuse */
+    void release(std::unique_ptr<wf::owned_texture_t> texture);
+
+    /** Free all pooled textures */
+    void clear();
+
+  private:
+    texture_pool_t() = default;
+
+    /** Upper bound for the textures waiting for reuse */
+    static constexpr size_t MAX_POOLED = 16;
+
+    /** Most recently released last */
+    std::vector<std::unique_ptr<wf::owned_texture_t>> pooled;
+    std::unique_ptr<cache_entry_t> entry;
+
+    /** @return A pooled texture of the given size, or nullptr */
+    std::unique_ptr<wf::owned_texture_t> take(wf::dimensions_t size);
+    /** Upload @surface into the storage of @texture, if the renderer allows */
+    static bool update_in_place(wf::owned_texture_t& texture, cairo_surface_t *surface);
+    void charge();
+};
+}
+}
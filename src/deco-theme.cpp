@@ -1,15 +1,25 @@
 #include "deco-theme.hpp"
+#include "deco-arena.hpp"
+#include "deco-assets.hpp"
+#include "deco-glyphs.hpp"
+#include "deco-shader.hpp"
+#include "deco-simd.hpp"
+#include "deco-textures.hpp"
+#include "deco-trace.hpp"
+#include "deco-worker.hpp"
 #include <wayfire/core.hpp>
 #include <wayfire/opengl.hpp>
 #include <fstream>
 #include <sstream>
 #include <regex>
 #include <algorithm>
+#include <cmath>
 #include <vector>
+#include <set>
 #include <sys/stat.h>
 
 #ifdef HAVE_LIBRSVG
-#include <librsvg/rsvg.h>
+#include "deco-svg.hpp"
 #endif
 
 namespace wf
@@ -59,6 +69,11 @@ wf::color_t decoration_theme_t::parse_css_color(const std::string& color_str) co
 /** Get current GTK theme name from settings */
 std::string decoration_theme_t::get_gtk_theme_name() const
 {
+    if (!gtk_theme_override.empty())
+    {
+        return gtk_theme_override;
+    }
+
     const char* home = getenv("HOME");
     if (!home)
     {
@@ -88,6 +103,11 @@ std::string decoration_theme_t::get_gtk_theme_name() const
 /** Get current icon theme name from settings */
 std::string decoration_theme_t::get_icon_theme_name() const
 {
+    if (!icon_theme_override.empty())
+    {
+        return icon_theme_override;
+    }
+
     const char* home = getenv("HOME");
     if (!home)
     {
@@ -143,8 +163,82 @@ std::string decoration_theme_t::get_gtk_font_name() const
     return "";
 }
 
-/** Find theme CSS file path */
+/** stat() wrapper which counts the calls made by the finders */
+bool decoration_theme_t::file_exists(const std::string& path) const
+{
+    stats.count(STAT_FINDER_STAT);
+    struct stat buffer;
+    return stat(path.c_str(), &buffer) == 0;
+}
+
+/**
+ * Look a theme file up through the shared lookup cache. Every decoration
+ * asks for the same few files, and each uncached lookup stats dozens of
+ * candidate paths.
+ */
+std::string decoration_theme_t::find_cached(const std::string& key,
+    const std::function<std::string()>& lookup) const
+{
+    auto& cache = path_lookup_cache_t::get();
+    std::string path;
+    if (cache.find(key, path))
+    {
+        stats.count(STAT_FINDER_CACHE_HIT);
+        return path;
+    }
+
+    path = lookup();
+    cache.insert(key, path);
+    return path;
+}
+
 std::string decoration_theme_t::find_theme_css_file(const std::string& theme_name) const
+{
+    return find_cached("css:" + theme_name, [&] ()
+    {
+        return lookup_theme_css_file(theme_name);
+    });
+}
+
+std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
+    const button_state_t& state) const
+{
+    const auto query = get_titlebutton_query(button, state);
+    return find_cached(query.get_key(), [&] ()
+    {
+        return lookup_titlebutton_file(query);
+    });
+}
+
+decoration_theme_t::titlebutton_query_t decoration_theme_t::get_titlebutton_query(
+    button_type_t button, const button_state_t& state) const
+{
+    return titlebutton_query_t{
+        .theme     = gtk_theme_name,
+        .button    = button,
+        .pressed   = state.hover_progress < 0,
+        .hovered   = state.hover_progress > 0,
+        .activated = state.activated,
+    };
+}
+
+std::string decoration_theme_t::titlebutton_query_t::get_key() const
+{
+    return "titlebutton:" + theme + ":" + std::to_string(button) +
+           (pressed ? ":pressed" : "") + (hovered ? ":hovered" : "") +
+           (activated ? ":focused" : ":backdrop");
+}
+
+std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int size) const
+{
+    return find_cached("icon:" + icon_theme_name + ":" + icon_name + "@" + std::to_string(size), [&] ()
+    {
+        return lookup_icon_file(icon_name, size);
+    });
+}
+
+/** Find theme CSS file path */
+std::string decoration_theme_t::lookup_theme_css_file(const std::string& theme_name) const
 {
     if (theme_name.empty())
     {
@@ -166,8 +260,7 @@ std::string decoration_theme_t::find_theme_css_file(const std::string& theme_nam
 
     for (const auto& path : search_paths)
     {
-        struct stat buffer;
-        if (stat(path.c_str(), &buffer) == 0)
+        if (file_exists(path))
         {
             return path;
         }
@@ -190,16 +283,15 @@ std::string decoration_theme_t::find_theme_css_file(const std::string& theme_nam
  * Unlike the symbolic icons used by the drawn style, these are not masks:
  * the colour is baked in, so they are painted as-is.
  */
-std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
-    const button_state_t& state) const
+std::string decoration_theme_t::lookup_titlebutton_file(const titlebutton_query_t& query) const
 {
-    if (gtk_theme_name.empty())
+    if (query.theme.empty())
     {
         return "";
     }
 
     std::string action;
-    switch (button)
+    switch (query.button)
     {
       case BUTTON_CLOSE:
         action = "close";
@@ -217,8 +309,8 @@ std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
         return "";
     }
 
-    const bool pressed = state.hover_progress < 0;
-    const bool hovered = state.hover_progress > 0;
+    const bool pressed = query.pressed;
+    const bool hovered = query.hovered;
 
     /* Two naming conventions are in the wild, and a theme uses one or the
      * other, so both are tried at each state:
@@ -235,7 +327,7 @@ std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
         candidates.push_back("/metacity-1/" + action + classic);
     };
 
-    if (!state.activated)
+    if (!query.activated)
     {
         if (pressed)
         {
@@ -280,9 +372,8 @@ std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
         {
             for (const auto *ext : {".svg", ".png"})
             {
-                const std::string path = base + gtk_theme_name + candidate + ext;
-                struct stat buffer;
-                if (stat(path.c_str(), &buffer) == 0)
+                const std::string path = base + query.theme + candidate + ext;
+                if (file_exists(path))
                 {
                     return path;
                 }
@@ -293,89 +384,8 @@ std::string decoration_theme_t::find_titlebutton_file(button_type_t button,
     return "";
 }
 
-/**
- * Render a titlebutton asset at @size, cached so the SVG is not re-parsed on
- * every frame of the hover animation.
- */
-cairo_surface_t*decoration_theme_t::get_titlebutton_asset(const std::string& path, int size) const
-{
-    if (size <= 0)
-    {
-        return nullptr;
-    }
-
-    const std::string key = path + "@" + std::to_string(size);
-    auto it = titlebutton_cache.find(key);
-    if (it != titlebutton_cache.end())
-    {
-        return it->second;
-    }
-
-    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
-    cairo_t *cr = cairo_create(surface);
-    cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
-    bool ok = false;
-
-    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".png") == 0)
-    {
-        cairo_surface_t *png = cairo_image_surface_create_from_png(path.c_str());
-        if (cairo_surface_status(png) == CAIRO_STATUS_SUCCESS)
-        {
-            const double sw = cairo_image_surface_get_width(png);
-            const double sh = cairo_image_surface_get_height(png);
-            if ((sw > 0) && (sh > 0))
-            {
-                cairo_scale(cr, size / sw, size / sh);
-                cairo_set_source_surface(cr, png, 0, 0);
-                cairo_paint(cr);
-                ok = true;
-            }
-        }
-
-        cairo_surface_destroy(png);
-    }
-#ifdef HAVE_LIBRSVG
-    else
-    {
-        GError *error = NULL;
-        RsvgHandle *handle = rsvg_handle_new_from_file(path.c_str(), &error);
-        if (handle)
-        {
-            /* Full-bleed: the asset is the whole button, padding is the
-             * theme's business, not ours. */
-            RsvgRectangle viewport = {
-                .x = 0.0,
-                .y = 0.0,
-                .width  = (double)size,
-                .height = (double)size
-            };
-            ok = rsvg_handle_render_document(handle, cr, &viewport, &error);
-            g_object_unref(handle);
-        }
-
-        if (error)
-        {
-            LOGE("Failed to render titlebutton ", path, ": ", error->message);
-            g_error_free(error);
-        }
-    }
-#endif
-
-    cairo_destroy(cr);
-
-    if (!ok)
-    {
-        cairo_surface_destroy(surface);
-        titlebutton_cache[key] = nullptr;  // negative cache, don't retry every frame
-        return nullptr;
-    }
-
-    titlebutton_cache[key] = surface;
-    return surface;
-}
-
 /** Find icon file path in icon theme */
-std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int size) const
+std::string decoration_theme_t::lookup_icon_file(const std::string& icon_name, int size) const
 {
     if (icon_theme_name.empty() || icon_name.empty())
     {
@@ -415,28 +425,27 @@ std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int
                 // Try both possible directory orderings for maximum compatibility
                 // Pattern 1: theme/size/subdir/icon (e.g., Adwaita/symbolic/ui/icon.svg)
                 std::string path = base + "/" + icon_theme_name + "/" + size_dir + "/" + sub_dir + "/" + icon_name + ".svg";
-                struct stat buffer;
-                if (stat(path.c_str(), &buffer) == 0)
+                if (file_exists(path))
                 {
                     return path;
                 }
 
                 // Pattern 2: theme/subdir/size/icon (e.g., elementary/actions/symbolic/icon.svg)
                 path = base + "/" + icon_theme_name + "/" + sub_dir + "/" + size_dir + "/" + icon_name + ".svg";
-                if (stat(path.c_str(), &buffer) == 0)
+                if (file_exists(path))
                 {
                     return path;
                 }
 
                 // Try PNG for both patterns
                 path = base + "/" + icon_theme_name + "/" + size_dir + "/" + sub_dir + "/" + icon_name + ".png";
-                if (stat(path.c_str(), &buffer) == 0)
+                if (file_exists(path))
                 {
                     return path;
                 }
 
                 path = base + "/" + icon_theme_name + "/" + sub_dir + "/" + size_dir + "/" + icon_name + ".png";
-                if (stat(path.c_str(), &buffer) == 0)
+                if (file_exists(path))
                 {
                     return path;
                 }
@@ -444,14 +453,13 @@ std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int
 
             // Also try without subdirectory
             std::string path = base + "/" + icon_theme_name + "/" + size_dir + "/" + icon_name + ".svg";
-            struct stat buffer;
-            if (stat(path.c_str(), &buffer) == 0)
+            if (file_exists(path))
             {
                 return path;
             }
 
             path = base + "/" + icon_theme_name + "/" + size_dir + "/" + icon_name + ".png";
-            if (stat(path.c_str(), &buffer) == 0)
+            if (file_exists(path))
             {
                 return path;
             }
@@ -464,8 +472,7 @@ std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int
         for (const auto& base : base_paths)
         {
             std::string path = base + "/Adwaita/symbolic/ui/" + icon_name + ".svg";
-            struct stat buffer;
-            if (stat(path.c_str(), &buffer) == 0)
+            if (file_exists(path))
             {
                 return path;
             }
@@ -478,6 +485,7 @@ std::string decoration_theme_t::find_icon_file(const std::string& icon_name, int
 /** Parse theme CSS file and extract colors */
 void decoration_theme_t::parse_theme_css(const std::string& css_file) const
 {
+    DECO_TRACE_SPAN("parse_theme_css");
     std::ifstream file(css_file);
     if (!file.is_open())
     {
@@ -579,6 +587,9 @@ void decoration_theme_t::load_gtk_theme() const
     }
 
     theme_loaded = true;  // Mark as attempted even if it fails
+    stats.count(STAT_THEME_LOAD);
+    stat_timer_scope_t timing{stats, TIMER_THEME_LOAD};
+    DECO_TRACE_SPAN("load_gtk_theme");
 
     // Get icon theme name from GTK settings
     icon_theme_name = get_icon_theme_name();
@@ -610,6 +621,8 @@ void decoration_theme_t::load_gtk_theme() const
     // Get theme name from GTK settings
     std::string theme_name = get_gtk_theme_name();
     gtk_theme_name = theme_name;  // cached for titlebutton asset lookup
+    prerender_button_assets();
+    warm_up_fonts();
     if (theme_name.empty())
     {
         LOGE("Could not determine GTK theme name, using fallback colors");
@@ -675,32 +688,37 @@ decoration_theme_t::decoration_theme_t() :
     theme_font_family(""),
     theme_font_size(0)
 {
-}
-
-decoration_theme_t::~decoration_theme_t()
-{
-    clear_titlebutton_cache();
-}
-
-void decoration_theme_t::clear_titlebutton_cache() const
-{
-    for (auto& [key, surface] : titlebutton_cache)
+    bg_cache.entry = std::make_unique<cache_entry_t>(CACHE_BACKGROUND, [this] ()
     {
-        cairo_surface_destroy(surface);
-    }
-
-    titlebutton_cache.clear();
+        release_bg_textures();
+    });
 }
 
+/** Fonts warmed up since the themes were last reloaded, see warm_up_fonts() */
+static std::set<std::string> warmed_up_fonts;
+
 /** Force reload of theme - call when GTK theme/icon theme changes */
 void decoration_theme_t::reload_theme() const
 {
     LOGI("Reloading GTK theme and icons");
+    stats.count(STAT_THEME_RELOAD);
     invalidate_cache();
-    clear_titlebutton_cache();
+    asset_cache_t::get().clear();
+    path_lookup_cache_t::get().clear();
+    /* Fonts may have been installed or reconfigured since */
+    warmed_up_fonts.clear();
+#ifdef HAVE_LIBRSVG
+    svg_document_cache_t::get().clear();
+#endif
+    auto& budget = texture_budget_t::get();
+    LOGI("Decoration caches: ", budget.get_usage() / 1024, " KiB in ",
+        budget.get_entry_count(), " entries (budget ",
+        budget.get_budget() ? std::to_string(budget.get_budget() / 1024) + " KiB" : "unlimited",
+        ", ", budget.get_eviction_count(), " evictions so far)");
     theme_loaded = false;
     icon_theme_name.clear();
     gtk_theme_name.clear();
+    title_font.clear();
     theme_font_family.clear();
     theme_font_size = 0;
     // Reset colors to defaults - they'll be reloaded
@@ -710,6 +728,41 @@ void decoration_theme_t::reload_theme() const
     theme_titlebar_fg_inactive = wf::color_t{0.7, 0.7, 0.73, 0.7};
 }
 
+decoration_stats_t& decoration_theme_t::get_stats() const
+{
+    return stats;
+}
+
+void decoration_theme_t::set_renderers(const std::string& frame, const std::string& title)
+{
+    frame_renderer_override = frame;
+    title_renderer_override = title;
+}
+
+void decoration_theme_t::set_theme_names(const std::string& gtk_theme,
+    const std::string& icon_theme)
+{
+    gtk_theme_override  = gtk_theme;
+    icon_theme_override = icon_theme;
+}
+
+void decoration_theme_t::clear_frame_cache() const
+{
+    release_bg_textures();
+    bg_cache.entry->release();
+}
+
+void decoration_theme_t::set_owner(uint64_t owner)
+{
+    this->owner = owner;
+    bg_cache.entry->set_owner(owner);
+}
+
+uint64_t decoration_theme_t::get_owner() const
+{
+    return owner;
+}
+
 /** @return The available height for displaying the title */
 int decoration_theme_t::get_title_height() const
 {
@@ -728,15 +781,130 @@ int decoration_theme_t::get_corner_radius() const
     return corner_radius;
 }
 
+/** @return How far the drop shadow reaches beyond the decoration */
+int decoration_theme_t::get_shadow_extent() const
+{
+    if (decoration_shaders_t::is_supported())
+    {
+        return decoration_shaders_t::get_shadow_extent(shadow_radius,
+            wf::pointf_t{0.0, (double)shadow_offset});
+    }
+
+    return get_cairo_shadow_margin();
+}
+
 /** @return The available border for resizing */
 void decoration_theme_t::set_buttons(button_type_t flags)
 {
     button_flags = flags;
 }
 
+/** Titlebar and border color: the theme's, or the configured fallback */
+wf::color_t decoration_theme_t::get_background_color(bool active) const
+{
+    // Use theme colors if available, otherwise fall back to config colors
+    wf::color_t bg_color = active ? theme_titlebar_bg_active : theme_titlebar_bg_inactive;
+
+    // If theme colors are still default (black), use config colors as ultimate fallback
+    if (bg_color.r == 0.0 && bg_color.g == 0.0 && bg_color.b == 0.0)
+    {
+        bg_color = active ? active_color : inactive_color;
+    }
+
+    return bg_color;
+}
+
+/** Color of the 1px outline around the whole decoration */
+wf::color_t decoration_theme_t::get_outline_color() const
+{
+    // Use a lighter semi-transparent border to contrast with dark backgrounds (like native GTK)
+    return wf::color_t{1.0, 1.0, 1.0, 0.10};
+}
+
 void decoration_theme_t::invalidate_cache() const
 {
-    bg_cache.valid = false;
+    for (auto& part : bg_cache.parts)
+    {
+        part.size = {0, 0};
+    }
+}
+
+void decoration_theme_t::release_bg_textures() const
+{
+    for (auto& part : bg_cache.parts)
+    {
+        part.tex.reset();
+        part.size  = {0, 0};
+        part.bytes = 0;
+    }
+}
+
+/** @return The size of the blurred shadow template, see get_shadow_template() */
+static wf::dimensions_t get_shadow_template_size(int radius, int top_radius,
+    int bottom_radius)
+{
+    const int extent = 3 * radius;
+    return {
+        2 * std::max(top_radius, bottom_radius) + 4 * extent + 1,
+        top_radius + bottom_radius + 4 * extent + 1,
+    };
+}
+
+bool decoration_theme_t::is_frame_part_current(frame_part_t part, wf::dimensions_t size,
+    bool active) const
+{
+    const auto& cached = bg_cache.parts[part];
+    if (!cached.tex || (cached.active != active) || (cached.margin != get_cairo_shadow_margin()) ||
+        (cached.size.width <= 0) || (cached.size.height <= 0))
+    {
+        return false;
+    }
+
+    /* A shadow smaller than its template is not stretched but cut, in both
+     * dimensions, so every part depends on both */
+    if (get_cairo_shadow_margin() > 0)
+    {
+        const int radius   = get_cairo_shadow_radius();
+        const auto minimum = get_shadow_template_size(radius, corner_radius, bottom_corner_radius);
+        const int extent   = 3 * radius;
+        auto is_small = [&] (wf::dimensions_t frame)
+        {
+            return (frame.width + 2 * extent < minimum.width) ||
+                   (frame.height + 2 * extent < minimum.height);
+        };
+
+        if (is_small(size) || is_small(cached.size))
+        {
+            return cached.size == size;
+        }
+    }
+
+    /* Titlebar and bottom only stretch horizontally, the sides only
+     * vertically; the other dimension just moves them. */
+    switch (part)
+    {
+      case FRAME_PART_TITLEBAR:
+      case FRAME_PART_BOTTOM:
+        return cached.size.width == size.width;
+
+      default:
+        return cached.size.height == size.height;
+    }
+}
+
+/** @return Whether any damaged box overlaps @box */
+static bool damage_intersects(const wf::regionf_t& damage, const wf::geometry_t& box)
+{
+    for (const auto& damaged : damage)
+    {
+        if ((damaged.x < box.x + box.width) && (box.x < damaged.x + damaged.width) &&
+            (damaged.y < box.y + box.height) && (box.y < damaged.y + damaged.height))
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /**
@@ -752,84 +920,203 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
     // Lazy initialization: load GTK theme on first render
     load_gtk_theme();
 
-    // Check if cached surfaces are still valid
-    bool cache_hit = bg_cache.valid &&
-        bg_cache.geometry.width == rectangle.width &&
-        bg_cache.geometry.height == rectangle.height &&
-        bg_cache.active == active;
+    // With GLES, the shadow is drawn analytically and kept out of the surfaces
+    const bool gl_shadow = decoration_shaders_t::is_supported();
+    if (gl_shadow)
+    {
+        decoration_shaders_t::get().render_shadow(data, shadow_params_t{
+            .frame  = rectangle,
+            .top_radius    = (double)corner_radius,
+            .bottom_radius = (double)bottom_corner_radius,
+            .radius = (double)(int)shadow_radius,
+            .offset = {0.0, (double)(int)shadow_offset},
+            .color  = shadow_color,
+        });
+    }
 
-    if (cache_hit)
+    // Shader frame: no surfaces at all, everything is computed per pixel
+    const std::string renderer = frame_renderer_override.empty() ?
+        std::string(frame_renderer) : frame_renderer_override;
+    if (gl_shadow && (renderer == "shader"))
     {
-        // Just re-submit cached textures
-        if (bg_cache.titlebar_tex)
+        if (bg_cache.entry->get_size() > 0)
         {
-            data.pass->add_texture(bg_cache.titlebar_tex->get_texture(),
-                data.target, bg_cache.titlebar_rect + wf::pointf_t{rectangle.x, rectangle.y}
-                    - wf::pointf_t{bg_cache.geometry.x, bg_cache.geometry.y}, data.damage);
+            release_bg_textures();
+            bg_cache.entry->release();
         }
-        if (bg_cache.left_tex)
+
+        const int titlebar_h = title_height + border_size;
+        decoration_shaders_t::get().render_frame(data, frame_params_t{
+            .frame   = rectangle,
+            .content = {
+                rectangle.x + border_size, rectangle.y + titlebar_h,
+                rectangle.width - 2.0 * border_size,
+                rectangle.height - titlebar_h - (double)border_size
+            },
+            .top_radius    = (double)corner_radius,
+            .bottom_radius = (double)bottom_corner_radius,
+            .fill    = get_background_color(active),
+            .outline = get_outline_color(),
+        });
+        return;
+    }
+
+    /* Only parts whose pixels changed are redrawn, and only once they are
+     * actually damaged: a hover in the titlebar of a resized window does not
+     * have to rebuild its borders as well. */
+    const wf::dimensions_t size = {(int)rectangle.width, (int)rectangle.height};
+    const wf::pointf_t origin   = {rectangle.x, rectangle.y};
+    bool cache_hit = true;
+    /* Textures of outdated parts, pooled only after the loop */
+    std::vector<std::unique_ptr<wf::owned_texture_t>> stale;
+    for (int i = 0; i < FRAME_PART_COUNT; i++)
+    {
+        const auto part = frame_part_t(i);
+        auto& cached    = bg_cache.parts[i];
+        cached.rect = get_frame_part_rect(part, rectangle.width, rectangle.height);
+        if (is_frame_part_current(part, size, active))
         {
-            data.pass->add_texture(bg_cache.left_tex->get_texture(),
-                data.target, bg_cache.left_rect + wf::pointf_t{rectangle.x, rectangle.y}
-                    - wf::pointf_t{bg_cache.geometry.x, bg_cache.geometry.y}, data.damage);
+            continue;
         }
-        if (bg_cache.right_tex)
+
+        cache_hit = false;
+        if (cached.tex)
         {
-            data.pass->add_texture(bg_cache.right_tex->get_texture(),
-                data.target, bg_cache.right_rect + wf::pointf_t{rectangle.x, rectangle.y}
-                    - wf::pointf_t{bg_cache.geometry.x, bg_cache.geometry.y}, data.damage);
+            stale.push_back(std::move(cached.tex));
         }
-        if (bg_cache.bottom_tex)
+
+        cached.size  = {0, 0};
+        cached.bytes = 0;
+        if (!damage_intersects(data.damage, cached.rect + origin))
         {
-            data.pass->add_texture(bg_cache.bottom_tex->get_texture(),
-                data.target, bg_cache.bottom_rect + wf::pointf_t{rectangle.x, rectangle.y}
-                    - wf::pointf_t{bg_cache.geometry.x, bg_cache.geometry.y}, data.damage);
+            continue;
         }
-        if (bg_cache.outline_tex)
+
+        stat_timer_scope_t timing{stats, TIMER_BACKGROUND_MISS};
+        DECO_TRACE_SPAN("render_background miss");
+        stats.count(STAT_BACKGROUND_PART_RENDER);
+        auto surface = rasterize_frame_part(part, rectangle.width, rectangle.height,
+            active, !gl_shadow, cached.rect);
+        if (surface)
         {
-            data.pass->add_texture(bg_cache.outline_tex->get_texture(),
-                data.target, bg_cache.outline_rect + wf::pointf_t{rectangle.x, rectangle.y}
-                    - wf::pointf_t{bg_cache.geometry.x, bg_cache.geometry.y}, data.damage);
+            /* Updated in place if the same size, e.g. after a focus change */
+            const wf::dimensions_t surface_size = {cairo_image_surface_get_width(surface),
+                cairo_image_surface_get_height(surface)};
+            auto same_size = std::find_if(stale.begin(), stale.end(), [&] (const auto& tex)
+            {
+                return tex->get_size() == surface_size;
+            });
+            if (same_size != stale.end())
+            {
+                cached.tex = std::move(*same_size);
+                stale.erase(same_size);
+            }
+
+            texture_pool_t::get().upload(cached.tex, surface);
+            cached.size   = size;
+            cached.active = active;
+            cached.margin = get_cairo_shadow_margin();
+            cached.bytes  = static_cast<size_t>(cairo_image_surface_get_width(surface)) *
+                cairo_image_surface_get_height(surface) * 4;
+            cairo_surface_destroy(surface);
         }
-        return;
     }
 
-    // Cache miss — regenerate all surfaces
-    bg_cache.geometry = rectangle;
-    bg_cache.active = active;
-    bg_cache.valid = true;
+    for (auto& texture : stale)
+    {
+        texture_pool_t::get().release(std::move(texture));
+    }
 
-    // Use theme colors if available, otherwise fall back to config colors
-    wf::color_t bg_color = active ? theme_titlebar_bg_active : theme_titlebar_bg_inactive;
+    if (cache_hit)
+    {
+        stats.count(STAT_BACKGROUND_HIT);
+        bg_cache.entry->touch();
+    } else
+    {
+        stats.count(STAT_BACKGROUND_MISS);
+        size_t bytes = 0;
+        for (const auto& part : bg_cache.parts)
+        {
+            bytes += part.bytes;
+        }
 
-    // If theme colors are still default (black), use config colors as ultimate fallback
-    if (bg_color.r == 0.0 && bg_color.g == 0.0 && bg_color.b == 0.0)
+        bg_cache.entry->charge(bytes);
+    }
+
+    // Submit the cached textures; their rects are relative to the decoration
+    for (const auto& part : bg_cache.parts)
     {
-        bg_color = active ? active_color : inactive_color;
+        if (part.tex)
+        {
+            data.pass->add_texture(part.tex->get_texture(), data.target,
+                part.rect + wf::pointf_t{rectangle.x, rectangle.y}, data.damage);
+        }
     }
+}
 
-    // Use a lighter semi-transparent border to contrast with dark backgrounds (like native GTK)
-    wf::color_t outline_color;
-    outline_color.r = 1.0;
-    outline_color.g = 1.0;
-    outline_color.b = 1.0;
-    outline_color.a = 0.10;  // Subtle semi-transparent white border
+wf::geometry_t decoration_theme_t::get_frame_part_rect(frame_part_t part,
+    double width, double height) const
+{
+    const double blur = get_cairo_shadow_margin();
+    const double border = border_size;
+    const double r  = corner_radius;
+    const double br = bottom_corner_radius;
+    const double side_h = height - r - br + 1;
+
+    switch (part)
+    {
+      case FRAME_PART_TITLEBAR:
+        return {-blur, -blur, width + 2 * blur, title_height + border + blur};
+
+      case FRAME_PART_LEFT:
+        return (border > 0) ? wf::geometry_t{-blur, r - 1, border + blur, side_h} :
+               wf::geometry_t{0.0, r - 1, 1.0, side_h};
+
+      case FRAME_PART_RIGHT:
+        return (border > 0) ? wf::geometry_t{width - border, r - 1, border + blur, side_h} :
+               wf::geometry_t{width - 1, r - 1, 1.0, side_h};
+
+      case FRAME_PART_BOTTOM:
+        return (border > 0) ?
+               wf::geometry_t{-blur, height - border - br, width + 2 * blur, border + br + blur} :
+               wf::geometry_t{0.0, height - br, width, br};
+
+      default:
+        return {0.0, 0.0, 0.0, 0.0};
+    }
+}
+
+/**
+ * Rasterize one part of the cairo frame. Does not touch GL, so the frame can
+ * be rendered (and timed) without a render pass.
+ */
+cairo_surface_t*decoration_theme_t::rasterize_frame_part(frame_part_t part,
+    double width, double height, bool active, bool with_shadow, wf::geometry_t& rect) const
+{
+    const wf::color_t bg_color = get_background_color(active);
 
     // Calculate titlebar area (top portion with rounded corners)
     int titlebar_h = title_height + border_size;
-    wf::geometry_t titlebar_rect = {
-        rectangle.x, rectangle.y,
-        rectangle.width, (double)titlebar_h
-    };
 
-    // Shadow parameters
-    int shadow_offset = 2;
-    int shadow_blur = 3;
+    // Room for the shadow around the frame
+    const int margin = get_cairo_shadow_margin();
+
+    rect = get_frame_part_rect(part, width, height);
+    cairo_surface_t *surface = nullptr;
+    if ((border_size <= 0) && (part != FRAME_PART_TITLEBAR))
+    {
+        // Without borders, only the outline runs along the sides and bottom
+        surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32, rect.width, rect.height);
+        stroke_outline(surface, part, rect, width, height);
+        return surface;
+    }
 
-    // --- Titlebar surface ---
+    switch (part)
     {
-        auto titlebar_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-            titlebar_rect.width + shadow_blur * 2, titlebar_rect.height + shadow_blur);
+      case FRAME_PART_TITLEBAR:
+      {
+        auto titlebar_surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32,
+            width + margin * 2, titlebar_h + margin);
         auto cr = cairo_create(titlebar_surface);
 
         cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
@@ -837,8 +1124,8 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
 
         double radius = corner_radius;
-        double x = shadow_blur, y = shadow_blur;
-        double w = titlebar_rect.width, h = titlebar_rect.height;
+        double x = margin, y = margin;
+        double w = width, h = titlebar_h;
 
         auto draw_rounded_rect_path = [&]() {
             cairo_new_sub_path(cr);
@@ -851,24 +1138,9 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         };
 
         // Drop shadow
-        for (int i = shadow_blur; i > 0; i--)
+        if (with_shadow)
         {
-            cairo_save(cr);
-            cairo_new_sub_path(cr);
-            double shadow_x = shadow_blur + 0.5;
-            double shadow_y = shadow_blur + shadow_offset + 0.5;
-            cairo_arc(cr, shadow_x + radius, shadow_y + radius, radius, M_PI, 3 * M_PI / 2);
-            cairo_line_to(cr, shadow_x + w - radius, shadow_y);
-            cairo_arc(cr, shadow_x + w - radius, shadow_y + radius, radius, -M_PI / 2, 0);
-            cairo_line_to(cr, shadow_x + w, shadow_y + h);
-            cairo_line_to(cr, shadow_x, shadow_y + h);
-            cairo_close_path(cr);
-
-            double alpha = 0.1 * (1.0 - (double)i / shadow_blur);
-            cairo_set_source_rgba(cr, 0, 0, 0, alpha);
-            cairo_set_line_width(cr, i * 2.0);
-            cairo_stroke(cr);
-            cairo_restore(cr);
+            paint_cairo_shadow(cr, part, rect, width, height);
         }
 
         draw_rounded_rect_path();
@@ -876,75 +1148,49 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         cairo_fill(cr);
         cairo_destroy(cr);
 
-        bg_cache.titlebar_rect = {
-            titlebar_rect.x - shadow_blur,
-            titlebar_rect.y - shadow_blur,
-            titlebar_rect.width + shadow_blur * 2,
-            titlebar_rect.height + shadow_blur
-        };
-        bg_cache.titlebar_tex = std::make_unique<wf::owned_texture_t>(titlebar_surface);
-        data.pass->add_texture(bg_cache.titlebar_tex->get_texture(), data.target,
-            bg_cache.titlebar_rect, data.damage);
-        cairo_surface_destroy(titlebar_surface);
-    }
+        surface = titlebar_surface;
+        break;
+      }
 
-    // --- Left border ---
-    if (border_size > 0)
-    {
-        int border_h = rectangle.height - corner_radius - bottom_corner_radius + 1;
-        auto left_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-            border_size + shadow_blur, border_h);
+      case FRAME_PART_LEFT:
+      {
+        int border_h = height - corner_radius - bottom_corner_radius + 1;
+        auto left_surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32,
+            border_size + margin, border_h);
         auto left_cr = cairo_create(left_surface);
 
         cairo_set_operator(left_cr, CAIRO_OPERATOR_CLEAR);
         cairo_paint(left_cr);
         cairo_set_operator(left_cr, CAIRO_OPERATOR_OVER);
 
-        for (int i = shadow_blur; i > 0; i--)
+        if (with_shadow)
         {
-            double alpha = 0.1 * (1.0 - (double)i / shadow_blur);
-            cairo_set_source_rgba(left_cr, 0, 0, 0, alpha);
-            cairo_set_line_width(left_cr, i * 2.0);
-            cairo_move_to(left_cr, shadow_blur + 0.5, 0);
-            cairo_line_to(left_cr, shadow_blur + 0.5, border_h);
-            cairo_stroke(left_cr);
+            paint_cairo_shadow(left_cr, part, rect, width, height);
         }
 
         cairo_set_source_rgba(left_cr, bg_color.r, bg_color.g, bg_color.b, bg_color.a);
-        cairo_rectangle(left_cr, shadow_blur, 0, border_size, border_h);
+        cairo_rectangle(left_cr, margin, 0, border_size, border_h);
         cairo_fill(left_cr);
         cairo_destroy(left_cr);
 
-        bg_cache.left_rect = {
-            rectangle.x - shadow_blur, rectangle.y + corner_radius - 1,
-            (double)(border_size + shadow_blur), (double)border_h
-        };
-        bg_cache.left_tex = std::make_unique<wf::owned_texture_t>(left_surface);
-        data.pass->add_texture(bg_cache.left_tex->get_texture(), data.target,
-            bg_cache.left_rect, data.damage);
-        cairo_surface_destroy(left_surface);
-    }
+        surface = left_surface;
+        break;
+      }
 
-    // --- Right border ---
-    if (border_size > 0)
-    {
-        int border_h = rectangle.height - corner_radius - bottom_corner_radius + 1;
-        auto right_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-            border_size + shadow_blur, border_h);
+      case FRAME_PART_RIGHT:
+      {
+        int border_h = height - corner_radius - bottom_corner_radius + 1;
+        auto right_surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32,
+            border_size + margin, border_h);
         auto right_cr = cairo_create(right_surface);
 
         cairo_set_operator(right_cr, CAIRO_OPERATOR_CLEAR);
         cairo_paint(right_cr);
         cairo_set_operator(right_cr, CAIRO_OPERATOR_OVER);
 
-        for (int i = shadow_blur; i > 0; i--)
+        if (with_shadow)
         {
-            double alpha = 0.1 * (1.0 - (double)i / shadow_blur);
-            cairo_set_source_rgba(right_cr, 0, 0, 0, alpha);
-            cairo_set_line_width(right_cr, i * 2.0);
-            cairo_move_to(right_cr, border_size - 0.5, 0);
-            cairo_line_to(right_cr, border_size - 0.5, border_h);
-            cairo_stroke(right_cr);
+            paint_cairo_shadow(right_cr, part, rect, width, height);
         }
 
         cairo_set_source_rgba(right_cr, bg_color.r, bg_color.g, bg_color.b, bg_color.a);
@@ -952,24 +1198,18 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         cairo_fill(right_cr);
         cairo_destroy(right_cr);
 
-        bg_cache.right_rect = {
-            rectangle.x + rectangle.width - border_size, rectangle.y + corner_radius - 1,
-            (double)(border_size + shadow_blur), (double)border_h
-        };
-        bg_cache.right_tex = std::make_unique<wf::owned_texture_t>(right_surface);
-        data.pass->add_texture(bg_cache.right_tex->get_texture(), data.target,
-            bg_cache.right_rect, data.damage);
-        cairo_surface_destroy(right_surface);
-    }
+        surface = right_surface;
+        break;
+      }
 
-    // --- Bottom border with rounded bottom corners ---
-    if (border_size > 0)
-    {
+      case FRAME_PART_BOTTOM:
+      {
+        // Bottom border with rounded bottom corners
         double br = bottom_corner_radius;
         int bottom_h = border_size + (int)br;  // Extra height for corner arcs
-        int surface_w = rectangle.width + shadow_blur * 2;
-        int surface_h = bottom_h + shadow_blur;
-        auto bottom_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+        int surface_w = width + margin * 2;
+        int surface_h = bottom_h + margin;
+        auto bottom_surface = surface_arena_t::get().create(CAIRO_FORMAT_ARGB32,
             surface_w, surface_h);
         auto bottom_cr = cairo_create(bottom_surface);
 
@@ -977,32 +1217,16 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         cairo_paint(bottom_cr);
         cairo_set_operator(bottom_cr, CAIRO_OPERATOR_OVER);
 
-        // Draw shadow along the bottom with rounded corners
-        for (int i = shadow_blur; i > 0; i--)
+        // Shadow along the bottom, with its rounded corners
+        if (with_shadow)
         {
-            double alpha = 0.1 * (1.0 - (double)i / shadow_blur);
-            cairo_set_source_rgba(bottom_cr, 0, 0, 0, alpha);
-            cairo_set_line_width(bottom_cr, i * 2.0);
-
-            double sx = shadow_blur;
-            double sy = shadow_offset;
-            double sw = rectangle.width;
-
-            cairo_new_sub_path(bottom_cr);
-            cairo_move_to(bottom_cr, sx, sy + 0.5);
-            cairo_line_to(bottom_cr, sx + sw, sy + 0.5);
-            cairo_line_to(bottom_cr, sx + sw, sy + bottom_h - br + 0.5);
-            cairo_arc(bottom_cr, sx + sw - br, sy + bottom_h - br + 0.5, br, 0, M_PI / 2);
-            cairo_line_to(bottom_cr, sx + br, sy + bottom_h + 0.5);
-            cairo_arc(bottom_cr, sx + br, sy + bottom_h - br + 0.5, br, M_PI / 2, M_PI);
-            cairo_close_path(bottom_cr);
-            cairo_stroke(bottom_cr);
+            paint_cairo_shadow(bottom_cr, part, rect, width, height);
         }
 
         // Fill bottom area with rounded bottom corners
-        double bx = shadow_blur;
+        double bx = margin;
         double by = 0;
-        double bw = rectangle.width;
+        double bw = width;
 
         cairo_new_sub_path(bottom_cr);
         cairo_move_to(bottom_cr, bx, by);
@@ -1017,91 +1241,275 @@ void decoration_theme_t::render_background(const wf::scene::render_instruction_t
         cairo_fill(bottom_cr);
         cairo_destroy(bottom_cr);
 
-        bg_cache.bottom_rect = {
-            rectangle.x - shadow_blur,
-            rectangle.y + rectangle.height - border_size - (int)br,
-            (double)surface_w, (double)surface_h
-        };
-        bg_cache.bottom_tex = std::make_unique<wf::owned_texture_t>(bottom_surface);
-        data.pass->add_texture(bg_cache.bottom_tex->get_texture(), data.target,
-            bg_cache.bottom_rect, data.damage);
-        cairo_surface_destroy(bottom_surface);
-    }
-
-    // --- Unified outline: rounded top corners, rounded bottom corners ---
-    {
-        auto outline_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-            rectangle.width, rectangle.height);
-        auto outline_cr = cairo_create(outline_surface);
-
-        cairo_set_operator(outline_cr, CAIRO_OPERATOR_CLEAR);
-        cairo_paint(outline_cr);
-        cairo_set_operator(outline_cr, CAIRO_OPERATOR_OVER);
+        surface = bottom_surface;
+        break;
+      }
 
-        double r = corner_radius;
-        double br = bottom_corner_radius;
-        double w = rectangle.width;
-        double h = rectangle.height;
-
-        cairo_new_sub_path(outline_cr);
-        // Top-left arc
-        cairo_arc(outline_cr, 0.5 + r, 0.5 + r, r, M_PI, 3 * M_PI / 2);
-        // Top-right arc
-        cairo_arc(outline_cr, w - 0.5 - r, 0.5 + r, r, -M_PI / 2, 0);
-        // Down to bottom-right arc
-        cairo_line_to(outline_cr, w - 0.5, h - 0.5 - br);
-        cairo_arc(outline_cr, w - 0.5 - br, h - 0.5 - br, br, 0, M_PI / 2);
-        // Across bottom to bottom-left arc
-        cairo_arc(outline_cr, 0.5 + br, h - 0.5 - br, br, M_PI / 2, M_PI);
-        // Close path (up left side)
-        cairo_close_path(outline_cr);
-
-        cairo_set_source_rgba(outline_cr, outline_color.r, outline_color.g,
-            outline_color.b, outline_color.a);
-        cairo_set_line_width(outline_cr, 1.0);
-        cairo_stroke(outline_cr);
-        cairo_destroy(outline_cr);
-
-        bg_cache.outline_rect = {
-            rectangle.x, rectangle.y,
-            rectangle.width, rectangle.height
-        };
-        bg_cache.outline_tex = std::make_unique<wf::owned_texture_t>(outline_surface);
-        data.pass->add_texture(bg_cache.outline_tex->get_texture(), data.target,
-            bg_cache.outline_rect, data.damage);
-        cairo_surface_destroy(outline_surface);
+      default:
+        return nullptr;
     }
+
+    stroke_outline(surface, part, rect, width, height);
+    return surface;
 }
 
 /**
- * Render the given text on a cairo_surface_t with the given size.
- * The caller is responsible for freeing the memory afterwards.
+ * Where parts overlap, the rows go to the part submitted later, so its fill
+ * does not cover what the earlier part drew there.
  */
-cairo_surface_t*decoration_theme_t::render_text(const std::string& text,
-    int width, int height, int button_area_width) const
+void decoration_theme_t::get_part_band(frame_part_t part, const wf::geometry_t& rect,
+    double height, double& band_top, double& band_bottom) const
 {
-    const auto format = CAIRO_FORMAT_ARGB32;
-    auto surface = cairo_image_surface_create(format, width, height);
+    const double sides_y  = corner_radius - 1;
+    const double bottom_y = height - std::max(border_size, 0) - bottom_corner_radius;
 
-    if (height == 0)
+    band_top    = rect.y;
+    band_bottom = rect.y + rect.height;
+    switch (part)
     {
-        return surface;
+      case FRAME_PART_TITLEBAR:
+        band_bottom = sides_y;
+        break;
+
+      case FRAME_PART_LEFT:
+      case FRAME_PART_RIGHT:
+        band_top    = sides_y;
+        band_bottom = bottom_y;
+        break;
+
+      default:
+        band_top = bottom_y;
+        break;
     }
+}
 
-    // Lazy initialization: load GTK theme to get font settings
-    load_gtk_theme();
+/**
+ * A blurred rounded rectangle just large enough for its corners and edges,
+ * as an A8 mask. Any decoration's shadow is this stretched by repeating its
+ * middle row and column, so it is blurred once for all windows.
+ */
+struct shadow_template_t
+{
+    int radius = 0;
+    int top_radius    = 0;
+    int bottom_radius = 0;
+    int width  = 0;
+    int height = 0;
+    std::vector<uint8_t> alpha;
+};
+
+static const shadow_template_t& get_shadow_template(int radius, int top_radius,
+    int bottom_radius)
+{
+    static shadow_template_t shadow;
+    if (!shadow.alpha.empty() && (shadow.radius == radius) &&
+        (shadow.top_radius == top_radius) && (shadow.bottom_radius == bottom_radius))
+    {
+        return shadow;
+    }
 
-    wf::color_t color = theme_titlebar_fg_active;
-    // Use config font color as fallback
-    if (color.r == 0.0 && color.g == 0.0 && color.b == 0.0)
+    DECO_TRACE_SPAN("blur_shadow_template");
+    const int extent = 3 * radius;
+    const auto size  = get_shadow_template_size(radius, top_radius, bottom_radius);
+    shadow.radius = radius;
+    shadow.top_radius    = top_radius;
+    shadow.bottom_radius = bottom_radius;
+    shadow.width  = size.width;
+    shadow.height = size.height;
+
+    auto surface = cairo_image_surface_create(CAIRO_FORMAT_A8, shadow.width, shadow.height);
+    auto cr = cairo_create(surface);
+    const double x = extent, y = extent;
+    const double w = shadow.width - 2 * extent, h = shadow.height - 2 * extent;
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, x + top_radius, y + top_radius, top_radius, M_PI, 3 * M_PI / 2);
+    cairo_arc(cr, x + w - top_radius, y + top_radius, top_radius, -M_PI / 2, 0);
+    cairo_arc(cr, x + w - bottom_radius, y + h - bottom_radius, bottom_radius, 0, M_PI / 2);
+    cairo_arc(cr, x + bottom_radius, y + h - bottom_radius, bottom_radius, M_PI / 2, M_PI);
+    cairo_close_path(cr);
+    cairo_set_source_rgba(cr, 0, 0, 0, 1);
+    cairo_fill(cr);
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+
+    uint8_t *data    = cairo_image_surface_get_data(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    blur_alpha_mask(data, shadow.width, shadow.height, stride, radius);
+
+    shadow.alpha.resize(size_t(shadow.width) * shadow.height);
+    for (int row = 0; row < shadow.height; row++)
     {
-        color = font_color;
+        std::copy(data + size_t(row) * stride, data + size_t(row) * stride + shadow.width,
+            &shadow.alpha[size_t(row) * shadow.width]);
+    }
+
+    cairo_surface_destroy(surface);
+    return shadow;
+}
+
+/**
+ * @return The template row or column for position @pos of a shadow @full
+ *   pixels long, or -1 outside the shadow
+ */
+static int map_to_template(int pos, int full, int size)
+{
+    if ((pos < 0) || (pos >= full))
+    {
+        return -1;
+    }
+
+    const int middle   = size / 2;
+    const int from_end = full - 1 - pos;
+    if (pos < middle)
+    {
+        return pos;
+    } else if (from_end < size - 1 - middle)
+    {
+        return size - 1 - from_end;
+    }
+
+    return middle;
+}
+
+int decoration_theme_t::get_cairo_shadow_radius() const
+{
+    const double sigma = shadow_radius;
+    if ((sigma <= 0) || (wf::color_t(shadow_color).a <= 0))
+    {
+        return 0;
+    }
+
+    /* Three box passes of radius r have a variance of r * (r + 1) */
+    return std::clamp<int>(std::lround(std::sqrt(sigma * sigma + 0.25) - 0.5),
+        1, MAX_BLUR_RADIUS);
+}
+
+int decoration_theme_t::get_cairo_shadow_margin() const
+{
+    // With GLES, the shadow is drawn by the shader around the frame parts
+    const int radius = get_cairo_shadow_radius();
+    if (decoration_shaders_t::is_supported() || (radius <= 0))
+    {
+        return 0;
+    }
+
+    return 3 * radius + std::abs((int)shadow_offset);
+}
+
+void decoration_theme_t::paint_cairo_shadow(cairo_t *cr, frame_part_t part,
+    const wf::geometry_t& rect, double width, double height) const
+{
+    const int radius = get_cairo_shadow_radius();
+    if (radius <= 0)
+    {
+        return;
+    }
+
+    const auto& shadow = get_shadow_template(radius, corner_radius, bottom_corner_radius);
+    const int extent = 3 * radius;
+    const int offset = shadow_offset;
+    const int full_w = width + 2 * extent;
+    const int full_h = height + 2 * extent;
+
+    double band_top, band_bottom;
+    get_part_band(part, rect, height, band_top, band_bottom);
+
+    std::vector<int> columns(rect.width);
+    for (int i = 0; i < (int)rect.width; i++)
+    {
+        columns[i] = map_to_template(rect.x + i + extent, full_w, shadow.width);
+    }
+
+    auto mask = surface_arena_t::get().create(CAIRO_FORMAT_A8, rect.width, rect.height);
+    cairo_surface_flush(mask);
+    uint8_t *data    = cairo_image_surface_get_data(mask);
+    const int stride = cairo_image_surface_get_stride(mask);
+    for (int j = 0; j < (int)rect.height; j++)
+    {
+        const int y   = rect.y + j;
+        const int row = map_to_template(y - offset + extent, full_h, shadow.height);
+        if ((row < 0) || (y < band_top) || (y >= band_bottom))
+        {
+            continue;
+        }
+
+        const uint8_t *src = &shadow.alpha[size_t(row) * shadow.width];
+        uint8_t *dst = data + size_t(j) * stride;
+        for (int i = 0; i < (int)rect.width; i++)
+        {
+            dst[i] = (columns[i] < 0) ? 0 : src[columns[i]];
+        }
+    }
+
+    cairo_surface_mark_dirty(mask);
+
+    const wf::color_t color = shadow_color;
+    cairo_save(cr);
+    cairo_set_source_rgba(cr, color.r, color.g, color.b, color.a);
+    cairo_mask_surface(cr, mask, 0, 0);
+    cairo_restore(cr);
+    cairo_surface_destroy(mask);
+}
+
+/**
+ * Stroke the 1px outline of the whole decoration onto one frame part.
+ *
+ * Each part only draws the outline within its own horizontal band, so the
+ * translucent outline is never blended twice where parts overlap and no
+ * window-sized surface is needed for it. Where parts overlap, the band goes
+ * to the part submitted later, so its fill does not cover the outline.
+ */
+void decoration_theme_t::stroke_outline(cairo_surface_t *surface, frame_part_t part,
+    const wf::geometry_t& rect, double width, double height) const
+{
+    const wf::color_t outline_color = get_outline_color();
+    double band_top, band_bottom;
+    get_part_band(part, rect, height, band_top, band_bottom);
+    if (band_bottom <= band_top)
+    {
+        return;
     }
 
     auto cr = cairo_create(surface);
+    cairo_translate(cr, -rect.x, -rect.y);
+    cairo_rectangle(cr, rect.x, band_top, rect.width, band_bottom - band_top);
+    cairo_clip(cr);
+
+    double r  = corner_radius;
+    double br = bottom_corner_radius;
+    double w  = width;
+    double h  = height;
+
+    cairo_new_sub_path(cr);
+    // Top-left arc
+    cairo_arc(cr, 0.5 + r, 0.5 + r, r, M_PI, 3 * M_PI / 2);
+    // Top-right arc
+    cairo_arc(cr, w - 0.5 - r, 0.5 + r, r, -M_PI / 2, 0);
+    // Down to bottom-right arc
+    cairo_line_to(cr, w - 0.5, h - 0.5 - br);
+    cairo_arc(cr, w - 0.5 - br, h - 0.5 - br, br, 0, M_PI / 2);
+    // Across bottom to bottom-left arc
+    cairo_arc(cr, 0.5 + br, h - 0.5 - br, br, M_PI / 2, M_PI);
+    // Close path (up left side)
+    cairo_close_path(cr);
+
+    cairo_set_source_rgba(cr, outline_color.r, outline_color.g,
+        outline_color.b, outline_color.a);
+    cairo_set_line_width(cr, 1.0);
+    cairo_stroke(cr);
+    cairo_destroy(cr);
+}
 
-    PangoFontDescription *font_desc;
-    PangoLayout *layout;
+/**
+ * The title font: the GTK font from settings.ini, bold and scaled 1.12x to
+ * match the native GTK titlebar size. Resolved once per theme load.
+ */
+std::string decoration_theme_t::get_title_font() const
+{
+    if (!title_font.empty())
+    {
+        return title_font;
+    }
 
     // Use GTK font with scaling to match native GTK titlebar size
     std::string gtk_font_now = get_gtk_font_name();
@@ -1135,17 +1543,202 @@ cairo_surface_t*decoration_theme_t::render_text(const std::string& text,
         font_to_use = "Sans 11";
     }
 
-    font_desc = pango_font_description_from_string(font_to_use.c_str());
+    title_font = font_to_use;
+    return title_font;
+}
+
+/**
+ * Resolve the title font and the usual fallback fonts on the render worker,
+ * so the first title does not pay for fontconfig matching and font loading.
+ * Fontconfig and cairo's font caches are process-wide, but Pango's font map
+ * is per thread: once the worker is done, the compositor thread lays out the
+ * same text from an idle callback, for the glyph atlas and synchronous titles.
+ */
+void decoration_theme_t::warm_up_fonts() const
+{
+    /* Once per font, all decorations share the same caches */
+    static wf::wl_idle_call idle_warm_up;
+    const std::string font = get_title_font();
+    if (!warmed_up_fonts.insert(font).second)
+    {
+        return;
+    }
+
+    /* Latin, Cyrillic, Greek, CJK, Hangul, symbols and emoji */
+    const title_params_t params{
+        .text   = "Aa\u00c9\u00df \u0416\u0436 \u03a9\u03c9 \u6f22\u5b57\u304b\u306a \ud55c\uae00 \u2713 \U0001f600",
+        .width  = 1024,
+        .height = 64,
+        .button_area_width = 0,
+        .font  = font,
+        .color = {1, 1, 1, 1},
+    };
+
+    render_worker_t::get().submit([params] ()
+    {
+        DECO_TRACE_SPAN("warm_up_fonts");
+        cairo_surface_destroy(rasterize_title(params));
+    }, [params] ()
+    {
+        /* After the frame: the fonts are already matched and loaded */
+        idle_warm_up.run_once([params] ()
+        {
+            DECO_TRACE_SPAN("warm_up_fonts_main");
+            auto context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+            wf::point_t offset;
+            g_object_unref(create_title_layout(context, params, offset));
+            g_object_unref(context);
+        });
+    });
+}
+
+/** The title text color: the theme's, or the configured fallback */
+wf::color_t decoration_theme_t::get_title_color() const
+{
+    wf::color_t color = theme_titlebar_fg_active;
+    // Use config font color as fallback
+    if (color.r == 0.0 && color.g == 0.0 && color.b == 0.0)
+    {
+        color = font_color;
+    }
+
+    return color;
+}
+
+title_params_t decoration_theme_t::get_title_params(const std::string& text,
+    int width, int height, int button_area_width) const
+{
+    // Lazy initialization: load GTK theme to get font settings
+    load_gtk_theme();
+    return title_params_t{
+        .text   = text,
+        .width  = width,
+        .height = height,
+        .button_area_width = button_area_width,
+        .font  = get_title_font(),
+        .color = get_title_color(),
+    };
+}
+
+/** @return The title cache key: everything that affects the pixels */
+static std::string get_title_key(const title_params_t& params)
+{
+    std::ostringstream key;
+    key << params.font << '\n' << params.width << 'x' << params.height << '+' <<
+        params.button_area_width << '\n' << params.color.r << ',' << params.color.g << ',' <<
+        params.color.b << ',' << params.color.a << '\n' << params.text;
+    return key.str();
+}
+
+/**
+ * Get the title texture from the shared title cache, rendering and uploading
+ * it on a miss.
+ */
+std::shared_ptr<wf::owned_texture_t> decoration_theme_t::get_title_texture(
+    const std::string& text, int width, int height, int button_area_width) const
+{
+    const auto params = get_title_params(text, width, height, button_area_width);
+    const std::string key = get_title_key(params);
+
+    auto& cache = title_cache_t::get();
+    if (auto tex = cache.find(key, owner))
+    {
+        stats.count(STAT_TITLE_CACHE_HIT);
+        return tex;
+    }
+
+    stats.count(STAT_TITLE_CACHE_MISS);
+    auto surface = render_text(text, width, height, button_area_width);
+    auto tex = std::make_shared<wf::owned_texture_t>(surface);
+    cairo_surface_destroy(surface);
+    return cache.insert(key, std::move(tex), static_cast<size_t>(width) * height * 4, owner);
+}
+
+std::shared_ptr<wf::owned_texture_t> decoration_theme_t::get_title_texture_async(
+    const std::string& text, int width, int height, int button_area_width,
+    std::function<void(std::shared_ptr<wf::owned_texture_t>)> ready) const
+{
+    const auto params = get_title_params(text, width, height, button_area_width);
+    const std::string key = get_title_key(params);
+    if (auto tex = title_cache_t::get().find(key, owner))
+    {
+        stats.count(STAT_TITLE_CACHE_HIT);
+        return tex;
+    }
+
+    stats.count(STAT_TITLE_CACHE_MISS);
+    stats.count(STAT_TITLE_RENDER);
+
+    /* The job only sees the snapshot in params, never the theme, which may
+     * be gone by the time it finishes */
+    struct result_t
+    {
+        std::shared_ptr<cairo_surface_t> surface;
+        uint64_t us = 0;
+    };
+
+    auto result = std::make_shared<result_t>();
+    render_worker_t::get().submit([params, result] ()
+    {
+        auto start = std::chrono::steady_clock::now();
+        result->surface = std::shared_ptr<cairo_surface_t>(rasterize_title(params),
+            cairo_surface_destroy);
+        result->us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }, [params, key, result, owner = owner, ready = std::move(ready)] ()
+    {
+        decoration_stats_t::global().record(TIMER_TITLE_RENDER, result->us);
+        auto& cache = title_cache_t::get();
+        auto tex    = cache.find(key, owner);
+        if (!tex)
+        {
+            tex = cache.insert(key,
+                std::make_shared<wf::owned_texture_t>(result->surface.get()),
+                static_cast<size_t>(params.width) * params.height * 4, owner);
+        }
+
+        ready(tex);
+    });
 
-    layout = pango_cairo_create_layout(cr);
+    return nullptr;
+}
+
+/**
+ * Render the given text on a cairo_surface_t with the given size.
+ * The caller is responsible for freeing the memory afterwards.
+ */
+cairo_surface_t*decoration_theme_t::render_text(const std::string& text,
+    int width, int height, int button_area_width) const
+{
+    if (height == 0)
+    {
+        return surface_arena_t::get().create(CAIRO_FORMAT_ARGB32, width, height);
+    }
+
+    const auto params = get_title_params(text, width, height, button_area_width);
+    stats.count(STAT_TITLE_RENDER);
+    stat_timer_scope_t timing{stats, TIMER_TITLE_RENDER};
+    return rasterize_title(params, true);
+}
+
+PangoLayout*decoration_theme_t::create_title_layout(PangoContext *context,
+    const title_params_t& params, wf::point_t& offset)
+{
+    PangoFontDescription *font_desc;
+    PangoLayout *layout;
+
+    font_desc = pango_font_description_from_string(params.font.c_str());
+
+    layout = pango_layout_new(context);
     pango_layout_set_font_description(layout, font_desc);
-    pango_layout_set_text(layout, text.c_str(), text.size());
+    pango_layout_set_text(layout, params.text.c_str(), params.text.size());
+    pango_font_description_free(font_desc);
 
     // Reserve space for buttons on the left and mirror on the right for centering
-    int left_padding = (button_area_width > 0) ? button_area_width : 10;
+    int left_padding = (params.button_area_width > 0) ? params.button_area_width : 10;
     int right_padding = left_padding;  // Mirror for true visual centering
-    int text_width = width - left_padding - right_padding;
-    if (text_width < 0) text_width = width;  // Fallback if window too narrow
+    int text_width = params.width - left_padding - right_padding;
+    if (text_width < 0) text_width = params.width;  // Fallback if window too narrow
     int text_x = left_padding;
 
     // Center the text horizontally within the available space
@@ -1159,49 +1752,223 @@ cairo_surface_t*decoration_theme_t::render_text(const std::string& text,
     // Center vertically
     PangoRectangle ink_rect, logical_rect;
     pango_layout_get_pixel_extents(layout, &ink_rect, &logical_rect);
-    int text_y = (height - logical_rect.height) / 2 - logical_rect.y;
+    int text_y = (params.height - logical_rect.height) / 2 - logical_rect.y;
+
+    offset = {text_x, text_y};
+    return layout;
+}
+
+bool decoration_theme_t::use_glyph_atlas() const
+{
+    const std::string renderer = title_renderer_override.empty() ?
+        std::string(title_renderer) : title_renderer_override;
+    return (renderer == "atlas") && decoration_shaders_t::is_supported();
+}
+
+bool decoration_theme_t::render_title_glyphs(const wf::scene::render_instruction_t& data,
+    glyph_run_t& run, const std::string& text, wf::geometry_t geometry,
+    int button_area_width) const
+{
+    /* Laid out in output pixels, like the titles rendered with cairo */
+    const double scale = data.target.scale;
+    const auto params  = get_title_params(text, geometry.width * scale,
+        geometry.height * scale, button_area_width * scale);
+    return glyph_atlas_t::get().render(data, run, params, geometry, scale);
+}
+
+cairo_surface_t*decoration_theme_t::rasterize_title(const title_params_t& params,
+    bool from_arena)
+{
+    DECO_TRACE_SPAN("rasterize_title");
+    const int width  = params.width;
+    const int height = params.height;
+    const auto format = CAIRO_FORMAT_ARGB32;
+    auto surface = from_arena ? surface_arena_t::get().create(format, width, height) :
+        cairo_image_surface_create(format, width, height);
+    if (height == 0)
+    {
+        return surface;
+    }
+
+    const wf::color_t& color = params.color;
+    auto cr = cairo_create(surface);
+    auto context = pango_cairo_create_context(cr);
 
-    cairo_move_to(cr, text_x, text_y);
+    wf::point_t offset;
+    PangoLayout *layout = create_title_layout(context, params, offset);
+
+    cairo_move_to(cr, offset.x, offset.y);
     cairo_set_source_rgba(cr, color.r, color.g, color.b, color.a);
     pango_cairo_show_layout(cr, layout);
 
-    pango_font_description_free(font_desc);
     g_object_unref(layout);
+    g_object_unref(context);
     cairo_destroy(cr);
 
     return surface;
 }
 
-cairo_surface_t*decoration_theme_t::get_button_surface(button_type_t button,
+/**
+ * If the GTK theme ships metacity-1 titlebuttons and button_style allows
+ * them, the asset is the complete button - background, colour and glyph - so
+ * it replaces the drawn circle and symbolic icon entirely.
+ *
+ * @return Path to the asset for @button in @state, or "" to draw the button
+ */
+std::string decoration_theme_t::find_button_pixmap(button_type_t button,
     const button_state_t& state) const
 {
-    // Lazy initialization: load GTK theme on first render
+    const std::string style = button_style;
+    if (style == "gtk")
+    {
+        return "";
+    }
+
+    return find_titlebutton_file(button, state);
+}
+
+std::shared_ptr<wf::owned_texture_t> decoration_theme_t::get_button_texture(
+    button_type_t button, const button_state_t& state) const
+{
     load_gtk_theme();
+    const std::string asset = find_button_pixmap(button, state);
+    if (asset.empty())
+    {
+        return nullptr;
+    }
+
+    return asset_cache_t::get().get_texture({asset, static_cast<int>(state.width),
+        ASSET_FULL_BLEED}, owner);
+}
 
-    /* Pixmap style: if the GTK theme ships metacity-1 titlebuttons, the asset
-     * is the complete button - background, colour and glyph - so it replaces
-     * the drawn circle and symbolic icon entirely. */
+/** @return The name of the symbolic icon for @button in the icon theme */
+static std::string get_symbolic_icon_name(button_type_t button)
+{
+    switch (button)
+    {
+      case BUTTON_CLOSE:
+        return "window-close-symbolic";
+
+      case BUTTON_TOGGLE_MAXIMIZE:
+        return "window-maximize-symbolic";
+
+      case BUTTON_MINIMIZE:
+        return "window-minimize-symbolic";
+
+      default:
+        return "";
+    }
+}
+
+/** Scales of all outputs, set by the plugin */
+static std::vector<double> output_scales = {1.0};
+
+double decoration_theme_t::get_button_size(double scale) const
+{
+    return std::max(2.0, std::ceil(scale)) * 0.64 * title_height;
+}
+
+void decoration_theme_t::set_output_scales(const std::vector<double>& scales)
+{
+    output_scales = scales.empty() ? std::vector<double>{1.0} : scales;
+}
+
+const std::vector<double>& decoration_theme_t::get_output_scales()
+{
+    return output_scales;
+}
+
+/**
+ * Render every button image the configured buttons can show, in every state
+ * and at the button size of every output, on the render worker, so no
+ * decoration has to stall a frame for them later.
+ */
+void decoration_theme_t::prerender_button_assets() const
+{
+    std::set<int> sizes;
+    for (double scale : output_scales)
+    {
+        sizes.insert(static_cast<int>(get_button_size(scale)));
+    }
+
+    std::vector<asset_request_t> requests;
+    for (int size : sizes)
+    {
+        prerender_button_assets(size, requests);
+    }
+
+    asset_cache_t::get().prerender(requests);
+}
+
+void decoration_theme_t::prerender_button_assets(int size,
+    std::vector<asset_request_t>& requests) const
+{
     const std::string style = button_style;
-    if (style != "gtk")
+    for (auto button : {BUTTON_MINIMIZE, BUTTON_TOGGLE_MAXIMIZE, BUTTON_CLOSE})
     {
-        const std::string asset = find_titlebutton_file(button, state);
-        if (!asset.empty())
+        if (!(button_flags & button))
         {
-            cairo_surface_t *src = get_titlebutton_asset(asset, static_cast<int>(state.width));
-            if (src)
+            continue;
+        }
+
+        bool has_pixmaps = false;
+        if (style != "gtk")
+        {
+            for (bool activated : {true, false})
             {
-                cairo_surface_t *out = cairo_image_surface_create(
-                    CAIRO_FORMAT_ARGB32, state.width, state.height);
-                cairo_t *out_cr = cairo_create(out);
-                cairo_set_source_surface(out_cr, src, 0, 0);
-                cairo_paint(out_cr);
-                cairo_destroy(out_cr);
-                return out;
+                for (double hover : {0.0, 1.0, -1.0})
+                {
+                    const button_state_t state = {
+                        .width  = (double)size,
+                        .height = (double)size,
+                        .border = 2.0,
+                        .hover_progress = hover,
+                        .activated = activated,
+                    };
+                    const std::string path = find_titlebutton_file(button, state);
+                    if (!path.empty())
+                    {
+                        requests.push_back({path, size, ASSET_FULL_BLEED});
+                        has_pixmaps = true;
+                    }
+                }
             }
         }
+
+        if (!has_pixmaps)
+        {
+            const std::string path = find_icon_file(get_symbolic_icon_name(button), size);
+            if (path.find(".svg") != std::string::npos)
+            {
+                requests.push_back({path, size, ASSET_ICON});
+            }
+        }
+    }
+}
+
+cairo_surface_t*decoration_theme_t::get_button_surface(button_type_t button,
+    const button_state_t& state) const
+{
+    // Lazy initialization: load GTK theme on first render
+    load_gtk_theme();
+    stats.count(STAT_BUTTON_RENDER);
+    stat_timer_scope_t timing{stats, TIMER_BUTTON_RENDER};
+    DECO_TRACE_SPAN("get_button_surface");
+
+    /* Pixmap style: the asset is the complete button, shared read-only with
+     * the asset cache instead of copied */
+    const std::string asset = find_button_pixmap(button, state);
+    if (!asset.empty())
+    {
+        cairo_surface_t *src = asset_cache_t::get().get_surface(
+            {asset, static_cast<int>(state.width), ASSET_FULL_BLEED});
+        if (src)
+        {
+            return cairo_surface_reference(src);
+        }
     }
 
-    cairo_surface_t *button_surface = cairo_image_surface_create(
+    cairo_surface_t *button_surface = surface_arena_t::get().create(
         CAIRO_FORMAT_ARGB32, state.width, state.height);
 
     auto cr = cairo_create(button_surface);
@@ -1259,68 +2026,41 @@ cairo_surface_t*decoration_theme_t::get_button_surface(button_type_t button,
         }
 
         // Try to load icon from theme
-        std::string icon_name;
-        switch (button)
-        {
-          case BUTTON_CLOSE:
-            icon_name = "window-close-symbolic";
-            break;
-          case BUTTON_TOGGLE_MAXIMIZE:
-            icon_name = "window-maximize-symbolic";
-            break;
-          case BUTTON_MINIMIZE:
-            icon_name = "window-minimize-symbolic";
-            break;
-          default:
-            break;
-        }
-
-        std::string icon_path = find_icon_file(icon_name, static_cast<int>(state.width));
+        std::string icon_path = find_icon_file(get_symbolic_icon_name(button),
+            static_cast<int>(state.width));
         bool icon_loaded = false;
 
-#ifdef HAVE_LIBRSVG
         if (!icon_path.empty() && icon_path.find(".svg") != std::string::npos)
         {
-            GError *error = NULL;
-            RsvgHandle *handle = rsvg_handle_new_from_file(icon_path.c_str(), &error);
-
-            if (handle)
+            /* The cached A8 mask of the SVG, painted in the icon color; a
+             * color change never renders the SVG again */
+            cairo_surface_t *icon_mask = asset_cache_t::get().get_surface(
+                {icon_path, static_cast<int>(state.width), ASSET_ICON});
+            if (icon_mask)
             {
-                // Create temporary surface for the SVG
-                cairo_surface_t *icon_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                    state.width, state.height);
-                cairo_t *icon_cr = cairo_create(icon_surface);
-
-                // Render SVG with padding inside the button circle
-                double icon_size = state.width * 0.85;  // Match GTK size with visible padding
-                double offset = (state.width - icon_size) / 2.0;
-                RsvgRectangle viewport = {
-                    .x = offset,
-                    .y = offset,
-                    .width = icon_size,
-                    .height = icon_size
-                };
-
-                // Render SVG to temporary surface
-                if (rsvg_handle_render_document(handle, icon_cr, &viewport, &error))
+                auto to_byte = [] (double value)
                 {
-                    // Use the SVG as a mask and paint with the icon color
-                    cairo_set_source_rgba(cr, icon_color.r, icon_color.g, icon_color.b, icon_color.a);
-                    cairo_mask_surface(cr, icon_surface, 0, 0);
-                    icon_loaded = true;
-                }
-
-                cairo_destroy(icon_cr);
-                cairo_surface_destroy(icon_surface);
-                g_object_unref(handle);
-            }
-
-            if (error)
-            {
-                g_error_free(error);
+                    return uint32_t(std::lround(std::clamp(value, 0.0, 1.0) * 255.0));
+                };
+                const uint32_t color = (to_byte(icon_color.a) << 24) |
+                    (to_byte(icon_color.r * icon_color.a) << 16) |
+                    (to_byte(icon_color.g * icon_color.a) << 8) |
+                    to_byte(icon_color.b * icon_color.a);
+
+                cairo_surface_flush(button_surface);
+                paint_alpha_mask(cairo_image_surface_get_data(button_surface),
+                    cairo_image_surface_get_stride(button_surface),
+                    cairo_image_surface_get_data(icon_mask),
+                    cairo_image_surface_get_stride(icon_mask),
+                    std::min(cairo_image_surface_get_width(button_surface),
+                        cairo_image_surface_get_width(icon_mask)),
+                    std::min(cairo_image_surface_get_height(button_surface),
+                        cairo_image_surface_get_height(icon_mask)),
+                    color);
+                cairo_surface_mark_dirty(button_surface);
+                icon_loaded = true;
             }
         }
-#endif
 
         // Fallback to drawing icons if loading failed
         // cppcheck-suppress knownConditionTrueFalse
@@ -2,24 +2,44 @@
 #include <wayfire/render-manager.hpp>
 #include <wayfire/scene-render.hpp>
 #include "deco-button.hpp"
+#include "deco-cache.hpp"
+#include "deco-stats.hpp"
+#include <functional>
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
 
 namespace wf
 {
 namespace decor
 {
+struct glyph_run_t;
+struct asset_request_t;
+struct theme_probe_t;
+
 /**
  * A  class which manages the outlook of decorations.
  * It is responsible for determining the background colors, sizes, etc.
  */
+/** Everything needed to render a title, so it can be done on any thread */
+struct title_params_t
+{
+    std::string text;
+    int width;
+    int height;
+    /** Width occupied by buttons on the left side */
+    int button_area_width;
+    /** Pango font description */
+    std::string font;
+    wf::color_t color;
+};
+
 class decoration_theme_t
 {
   public:
     /** Create a new theme with the default parameters */
     decoration_theme_t();
-    ~decoration_theme_t();
 
     /** @return The available height for displaying the title */
     int get_title_height() const;
@@ -44,14 +64,99 @@ class decoration_theme_t
      */
     int get_corner_radius() const;
 
+    /** @return How far the drop shadow reaches beyond the decoration */
+    int get_shadow_extent() const;
+
+    /** The separately cached pieces of the cairo-rendered frame */
+    enum frame_part_t
+    {
+        FRAME_PART_TITLEBAR = 0,
+        FRAME_PART_LEFT     = 1,
+        FRAME_PART_RIGHT    = 2,
+        FRAME_PART_BOTTOM   = 3,
+        FRAME_PART_COUNT    = 4,
+    };
+
+    /**
+     * Rasterize one part of the cairo frame for a decoration of the given
+     * size. Needs no GL context or render pass.
+     * The caller is responsible for freeing the memory afterwards.
+     *
+     * @param with_shadow Whether to stroke the CPU drop shadow into the part
+     * @param rect Set to where the surface goes, relative to the decoration
+     * Every part carries its share of the 1px outline.
+     * @return The surface, or nullptr for an unknown part
+     */
+    cairo_surface_t *rasterize_frame_part(frame_part_t part, double width, double height,
+        bool active, bool with_shadow, wf::geometry_t& rect) const;
+
+    /** @return Where a frame part goes, relative to the decoration origin */
+    wf::geometry_t get_frame_part_rect(frame_part_t part, double width, double height) const;
+
     /**
-     * Render the given text on a cairo_surface_t with the given size.
+     * Render the given text on a cairo_surface_t with the given size, from
+     * the surface arena, so only on the main thread.
      * The caller is responsible for freeing the memory afterwards.
      * @param button_area_width Width occupied by buttons on the left side
      */
     cairo_surface_t *render_text(const std::string& text, int width, int height,
         int button_area_width = 0) const;
 
+    /**
+     * Get the rendered title as a texture. Titles are shared between all
+     * decorations and kept in a small LRU cache, so a title which flaps
+     * between a few values is only rendered once per value.
+     */
+    std::shared_ptr<wf::owned_texture_t> get_title_texture(const std::string& text,
+        int width, int height, int button_area_width = 0) const;
+
+    /**
+     * Like get_title_texture(), but a title which is not cached yet is
+     * rendered on the render worker instead of the calling thread.
+     *
+     * @param ready Called on the main thread with the texture once it is
+     *   available, unless it was cached already.
+     * @return The cached texture, or nullptr if @ready will be called.
+     */
+    std::shared_ptr<wf::owned_texture_t> get_title_texture_async(const std::string& text,
+        int width, int height, int button_area_width,
+        std::function<void(std::shared_ptr<wf::owned_texture_t>)> ready) const;
+
+    /**
+     * Render a title with no access to any theme. Safe to call from any
+     * thread, unless @from_arena.
+     *
+     * @param from_arena Draw into a surface of the surface arena, for titles
+     *   uploaded and destroyed right away on the main thread
+     */
+    static cairo_surface_t *rasterize_title(const title_params_t& params,
+        bool from_arena = false);
+
+    /**
+     * Lay out a title exactly as rasterize_title() draws it.
+     * The caller is responsible for freeing the layout afterwards.
+     *
+     * @param offset Set to where the layout's origin goes, in pixels
+     */
+    static PangoLayout *create_title_layout(PangoContext *context,
+        const title_params_t& params, wf::point_t& offset);
+
+    /** @return Whether titles are drawn from the shared glyph atlas */
+    bool use_glyph_atlas() const;
+
+    /**
+     * Draw a title from the shared glyph atlas, see use_glyph_atlas().
+     *
+     * @param run The glyphs of this decoration's title, laid out again
+     *   only when the text, size or font changes.
+     * @param geometry Where the title goes, in logical coordinates
+     * @param button_area_width In logical pixels
+     * @return false, without drawing, if the title does not fit in the atlas
+     */
+    bool render_title_glyphs(const wf::scene::render_instruction_t& data,
+        glyph_run_t& run, const std::string& text, wf::geometry_t geometry,
+        int button_area_width) const;
+
     struct button_state_t
     {
         /** Button width */
@@ -69,7 +174,9 @@ class decoration_theme_t
 
     /**
      * Get the icon for the given button.
-     * The caller is responsible for freeing the memory afterwards.
+     * The caller is responsible for freeing the memory afterwards. Pixmap
+     * buttons are shared with the asset cache and must not be drawn on; they
+     * may be up to twice the state's size and are scaled when drawn.
      *
      * @param button The button type.
      * @param state The button state.
@@ -77,10 +184,63 @@ class decoration_theme_t
     cairo_surface_t *get_button_surface(button_type_t button,
         const button_state_t& state) const;
 
+    /**
+     * Get the theme's pixmap for the given button as a GPU texture, shared
+     * with all other decorations.
+     *
+     * @return The texture, or nullptr if the button is drawn instead, in
+     *   which case get_button_surface() has to be used.
+     */
+    std::shared_ptr<wf::owned_texture_t> get_button_texture(button_type_t button,
+        const button_state_t& state) const;
+
+    /**
+     * @param scale The scale of the output the button is shown on
+     * @return Width and height of rendered buttons: twice their logical
+     *   size, or the output scale rounded up if that is more
+     */
+    double get_button_size(double scale = 1.0) const;
+
+    /** Set the scales of all outputs, whose buttons are pre-rendered on theme load */
+    static void set_output_scales(const std::vector<double>& scales);
+    /** @return The scales of all outputs, see set_output_scales() */
+    static const std::vector<double>& get_output_scales();
+
     // Force reload of theme (called when theme changes)
     void reload_theme() const;
 
+    /** @return Counters and timings of this decoration, see gtkdecor/stats */
+    decoration_stats_t& get_stats() const;
+
+    /**
+     * Draw with the given frame and title renderers instead of the configured
+     * ones, e.g. to compare them. Empty strings follow the options again.
+     */
+    void set_renderers(const std::string& frame, const std::string& title);
+
+    /**
+     * Use the given GTK and icon themes instead of those in the GTK
+     * settings, e.g. to compare renderers across themes. Empty strings
+     * follow the settings again. Takes effect on the next reload_theme().
+     */
+    void set_theme_names(const std::string& gtk_theme, const std::string& icon_theme);
+
+    /** Drop the cached frame parts, so the next render_background() starts cold */
+    void clear_frame_cache() const;
+
+    /**
+     * Attribute this decoration's cached textures to an owner token, unique
+     * to the decoration, and count the shared titles and pixmaps handed out
+     * to it as held by it, see gtkdecor/memory
+     */
+    void set_owner(uint64_t owner);
+    /** @return The owner token, 0 if not set */
+    uint64_t get_owner() const;
+
   private:
+    /** Reaches the theme loaders from the headless tests, see tests/ */
+    friend struct theme_probe_t;
+
     wf::option_wrapper_t<std::string> font{"gtkdecor/font"};
     wf::option_wrapper_t<wf::color_t> font_color{"gtkdecor/font_color"};
     wf::option_wrapper_t<int> title_height{"gtkdecor/title_height"};
@@ -90,11 +250,28 @@ class decoration_theme_t
     /** auto: use the GTK theme's metacity-1 titlebuttons if it ships them,
      * otherwise draw them; gtk: always draw; pixmap: only use theme assets */
     wf::option_wrapper_t<std::string> button_style{"gtkdecor/button_style"};
+    /** Drop shadow drawn by the GLES shader */
+    wf::option_wrapper_t<int> shadow_radius{"gtkdecor/shadow_radius"};
+    wf::option_wrapper_t<int> shadow_offset{"gtkdecor/shadow_offset"};
+    wf::option_wrapper_t<wf::color_t> shadow_color{"gtkdecor/shadow_color"};
+    /** cairo: rasterize the frame into cached textures; shader: draw it with
+     * a rounded-rect SDF (GLES only, falls back to cairo otherwise) */
+    wf::option_wrapper_t<std::string> frame_renderer{"gtkdecor/frame_renderer"};
+    /** cairo: render each title into its own texture; atlas: draw titles as
+     * glyph quads from a shared atlas (GLES only, falls back to cairo) */
+    wf::option_wrapper_t<std::string> title_renderer{"gtkdecor/title_renderer"};
+    /** Set by set_renderers(), take precedence over the options if not empty */
+    std::string frame_renderer_override;
+    std::string title_renderer_override;
+    /** Set by set_theme_names(), take precedence over the GTK settings if not empty */
+    std::string gtk_theme_override;
+    std::string icon_theme_override;
 
     // Rounded corner radii
     const int corner_radius = 12;        // Top corners
     const int bottom_corner_radius = 8;  // Bottom corners
 
+
     // GTK theme parsing (mutable for lazy initialization)
     mutable bool theme_loaded;
     mutable wf::color_t theme_titlebar_bg_active;
@@ -108,13 +285,23 @@ class decoration_theme_t
     mutable int theme_font_size;
     mutable std::string icon_theme_name;
     mutable std::string gtk_theme_name;
+    /** Resolved title font description, empty until first needed */
+    mutable std::string title_font;
+
+    mutable decoration_stats_t stats;
+    uint64_t owner = 0;
 
     void load_gtk_theme() const;
+    bool file_exists(const std::string& path) const;
     std::string get_gtk_theme_name() const;
     std::string get_icon_theme_name() const;
     std::string get_gtk_font_name() const;
+    std::string find_cached(const std::string& key,
+        const std::function<std::string()>& lookup) const;
     std::string find_theme_css_file(const std::string& theme_name) const;
+    std::string lookup_theme_css_file(const std::string& theme_name) const;
     std::string find_icon_file(const std::string& icon_name, int size) const;
+    std::string lookup_icon_file(const std::string& icon_name, int size) const;
 
     /**
      * Locate a metacity-1 titlebutton asset for the given button and state,
@@ -124,42 +311,77 @@ class decoration_theme_t
     std::string find_titlebutton_file(button_type_t button,
         const button_state_t& state) const;
 
-    /**
-     * Render a titlebutton asset at @size, cached by path and size so the
-     * SVG is not re-parsed on every frame of the hover animation.
-     * @return Borrowed surface owned by the cache, or nullptr on failure.
-     */
-    cairo_surface_t *get_titlebutton_asset(const std::string& path, int size) const;
+    /** Everything which selects a titlebutton asset */
+    struct titlebutton_query_t
+    {
+        std::string theme;
+        button_type_t button;
+        bool pressed;
+        bool hovered;
+        bool activated;
 
-    /** Rendered titlebutton assets, keyed by "<path>@<size>" */
-    mutable std::map<std::string, cairo_surface_t*> titlebutton_cache;
-    void clear_titlebutton_cache() const;
+        /** @return The lookup cache key, covering every member */
+        std::string get_key() const;
+    };
+
+    titlebutton_query_t get_titlebutton_query(button_type_t button,
+        const button_state_t& state) const;
+    std::string lookup_titlebutton_file(const titlebutton_query_t& query) const;
+
+    std::string find_button_pixmap(button_type_t button, const button_state_t& state) const;
+    void prerender_button_assets() const;
+    /** Add the button images of one size to @requests */
+    void prerender_button_assets(int size, std::vector<asset_request_t>& requests) const;
+    void warm_up_fonts() const;
     void parse_theme_css(const std::string& css_file) const;
     wf::color_t parse_css_color(const std::string& color_str) const;
 
     // Background surface cache — avoids recreating Cairo surfaces every frame
     mutable struct bg_cache_t
     {
-        wf::geometry_t geometry{};
-        bool active = false;
-        bool valid = false;
+        struct part_t
+        {
+            std::unique_ptr<wf::owned_texture_t> tex;
+            /** Where the texture goes, relative to the decoration origin */
+            wf::geometry_t rect{};
+            /** The decoration size the texture was drawn for. Only the
+             * dimensions the part's pixels depend on are compared. */
+            wf::dimensions_t size{0, 0};
+            bool active = false;
+            /** get_cairo_shadow_margin() when the texture was drawn */
+            int margin   = 0;
+            size_t bytes = 0;
+        } parts[FRAME_PART_COUNT];
 
-        std::unique_ptr<wf::owned_texture_t> titlebar_tex;
-        wf::geometry_t titlebar_rect{};
-
-        std::unique_ptr<wf::owned_texture_t> left_tex;
-        wf::geometry_t left_rect{};
-
-        std::unique_ptr<wf::owned_texture_t> right_tex;
-        wf::geometry_t right_rect{};
+        /** Accounts all of the above against the texture budget */
+        std::unique_ptr<cache_entry_t> entry;
+    } bg_cache;
+    title_params_t get_title_params(const std::string& text, int width, int height,
+        int button_area_width) const;
+    std::string get_title_font() const;
+    wf::color_t get_title_color() const;
+    wf::color_t get_background_color(bool active) const;
+    wf::color_t get_outline_color() const;
+    void stroke_outline(cairo_surface_t *surface, frame_part_t part,
+        const wf::geometry_t& rect, double width, double height) const;
 
-        std::unique_ptr<wf::owned_texture_t> bottom_tex;
-        wf::geometry_t bottom_rect{};
+    /* The shadow of the cairo path, used when the renderer is not GLES */
+    /** @return The box blur radius matching shadow_radius, 0 for no shadow */
+    int get_cairo_shadow_radius() const;
+    /** @return How far the cairo frame parts reach beyond the decoration */
+    int get_cairo_shadow_margin() const;
+    /** Paint the blurred shadow of the whole decoration onto one frame part */
+    void paint_cairo_shadow(cairo_t *cr, frame_part_t part, const wf::geometry_t& rect,
+        double width, double height) const;
+    /** The rows, relative to the decoration, which @part draws shared pixels in */
+    void get_part_band(frame_part_t part, const wf::geometry_t& rect, double height,
+        double& band_top, double& band_bottom) const;
 
-        std::unique_ptr<wf::owned_texture_t> outline_tex;
-        wf::geometry_t outline_rect{};
-    } bg_cache;
+    /** @return Whether the cached texture of @part can be drawn as it is */
+    bool is_frame_part_current(frame_part_t part, wf::dimensions_t size, bool active) const;
     void invalidate_cache() const;
+    /** Drop the cached background textures, e.g. on eviction */
+    void release_bg_textures() const;
 };
 }
 }
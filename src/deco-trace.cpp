@@ -0,0 +1,94 @@
+#include "deco-trace.hpp"
+
+#ifdef GTKDECOR_TRACING
+#include <wayfire/debug.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace wf
+{
+namespace decor
+{
+static int64_t monotonic_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Appends events in the JSON Array Format of the Chrome trace viewer and
+ * Perfetto, which accept the array without its closing bracket, so the
+ * file stays valid if the compositor dies mid-session.
+ */
+class trace_writer_t
+{
+  public:
+    static trace_writer_t& get()
+    {
+        static trace_writer_t writer;
+        return writer;
+    }
+
+    void write(const char *name, int64_t start_us, int64_t duration_us)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!file)
+        {
+            return;
+        }
+
+        fprintf(file, "{\"name\":\"%s\",\"cat\":\"gtkdecor\",\"ph\":\"X\","
+                      "\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%ld},\n",
+            name, (long long)start_us, (long long)duration_us, (int)getpid(),
+            (long)syscall(SYS_gettid));
+        fflush(file);
+    }
+
+  private:
+    trace_writer_t()
+    {
+        const char *path = getenv("GTKDECOR_TRACE_FILE");
+        if (!path || !*path)
+        {
+            path = "/tmp/gtkdecor-trace.json";
+        }
+
+        file = fopen(path, "w");
+        if (!file)
+        {
+            LOGE("Failed to open trace file ", path);
+            return;
+        }
+
+        fputs("[\n", file);
+        LOGI("Writing decoration trace to ", path);
+    }
+
+    ~trace_writer_t()
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    std::mutex mutex;
+    FILE *file = nullptr;
+};
+
+trace_span_t::trace_span_t(const char *name) :
+    name(name), start_us(monotonic_us())
+{}
+
+trace_span_t::~trace_span_t()
+{
+    trace_writer_t::get().write(name, start_us, monotonic_us() - start_us);
+}
+}
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * Optional tracing of decoration hot paths, enabled with -Dtracing=true.
+ *
+ * DECO_TRACE_SPAN("name") records the time until the end of the enclosing
+ * scope as a Chrome trace event ("ph": "X") in $GTKDECOR_TRACE_FILE, or
+ * /tmp/gtkdecor-trace.json. Timestamps are CLOCK_MONOTONIC microseconds, so
+ * they line up with other traces of the same session. Without the option, the
+ * macro expands to nothing.
+ */
+#ifdef GTKDECOR_TRACING
+#include <cstdint>
+
+namespace wf
+{
+namespace decor
+{
+class trace_span_t
+{
+  public:
+    explicit trace_span_t(const char *name);
+    ~trace_span_t();
+    trace_span_t(const trace_span_t&) = delete;
+    trace_span_t& operator =(const trace_span_t&) = delete;
+
+  private:
+    const char *name;
+    int64_t start_us;
+};
+}
+}
+
+#define DECO_TRACE_CONCAT_(a, b) a ## b
+#define DECO_TRACE_CONCAT(a, b) DECO_TRACE_CONCAT_(a, b)
+#define DECO_TRACE_SPAN(name) \
+    ::wf::decor::trace_span_t DECO_TRACE_CONCAT(deco_trace_span_, __LINE__){name}
+#else
+#define DECO_TRACE_SPAN(name) do {} while (0)
+#endif
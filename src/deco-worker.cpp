@@ -0,0 +1,155 @@
+#include "deco-worker.hpp"
+#include <wayfire/core.hpp>
+#include <wayfire/debug.hpp>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace wf
+{
+namespace decor
+{
+render_worker_t& render_worker_t::get()
+{
+    static render_worker_t worker;
+    return worker;
+}
+
+bool render_worker_t::start()
+{
+    if (thread.joinable())
+    {
+        return true;
+    }
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0)
+    {
+        LOGE("Failed to create eventfd, rendering titles on the main thread");
+        return false;
+    }
+
+    auto event_loop = wl_display_get_event_loop(wf::get_core().display);
+    event_source = wl_event_loop_add_fd(event_loop, event_fd, WL_EVENT_READABLE,
+        handle_finished, this);
+
+    stopping = false;
+    thread   = std::thread([this] { run(); });
+    return true;
+}
+
+void render_worker_t::submit(std::function<void()> work, std::function<void()> done)
+{
+    enqueue(queue, std::move(work), std::move(done));
+}
+
+void render_worker_t::submit_background(std::function<void()> work,
+    std::function<void()> done)
+{
+    enqueue(background, std::move(work), std::move(done));
+}
+
+void render_worker_t::enqueue(std::deque<job_t>& jobs, std::function<void()> work,
+    std::function<void()> done)
+{
+    if (!start())
+    {
+        work();
+        done();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job_t{std::move(work), std::move(done)});
+    }
+
+    wakeup.notify_one();
+}
+
+void render_worker_t::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeup.wait(lock, [this]
+        {
+            return stopping || !queue.empty() || !background.empty();
+        });
+        if (stopping)
+        {
+            return;
+        }
+
+        /* Checked again after every job, so a title submitted meanwhile
+         * overtakes the remaining background jobs */
+        auto& jobs = queue.empty() ? background : queue;
+        job_t job  = std::move(jobs.front());
+        jobs.pop_front();
+
+        lock.unlock();
+        job.work();
+        lock.lock();
+
+        finished.push_back(std::move(job.done));
+        const uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) < 0)
+        {
+            /* The counter is already non-zero, the main thread will wake up */
+        }
+    }
+}
+
+int render_worker_t::handle_finished(int fd, uint32_t, void *data)
+{
+    auto self = static_cast<render_worker_t*>(data);
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0)
+    {
+        return 0;
+    }
+
+    std::vector<std::function<void()>> done;
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        done.swap(self->finished);
+    }
+
+    for (auto& callback : done)
+    {
+        callback();
+    }
+
+    return 0;
+}
+
+void render_worker_t::stop()
+{
+    if (!thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wakeup.notify_one();
+    thread.join();
+
+    /* Results of dropped and finished jobs are freed with their callbacks */
+    queue.clear();
+    background.clear();
+    finished.clear();
+
+    if (event_source)
+    {
+        wl_event_source_remove(event_source);
+        event_source = nullptr;
+    }
+
+    close(event_fd);
+    event_fd = -1;
+}
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <wayland-server-core.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * A background thread for rendering work which must not stall a frame, e.g.
+ * laying out and rasterizing window titles.
+ *
+ * Jobs run one after another in submission order, background jobs only once
+ * no other job is waiting. Their completion callbacks run on the main thread
+ * from the event loop, and are the only place where results may be uploaded
+ * or added to the caches.
+ */
+class render_worker_t
+{
+  public:
+    static render_worker_t& get();
+
+    /**
+     * Run @work on the worker thread, then @done on the main thread. If the
+     * worker cannot be started, both run right away.
+     */
+    void submit(std::function<void()> work, std::function<void()> done);
+
+    /**
+     * Like submit(), for work nothing is waiting for yet, e.g. pre-rendering
+     * theme assets: it never delays a job passed to submit().
+     */
+    void submit_background(std::function<void()> work, std::function<void()> done);
+
+    /** Finish the running job, drop all others and stop the thread */
+    void stop();
+
+  private:
+    render_worker_t() = default;
+
+    struct job_t
+    {
+        std::function<void()> work;
+        std::function<void()> done;
+    };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<job_t> queue;
+    std::deque<job_t> background;
+    std::vector<std::function<void()>> finished;
+    bool stopping = false;
+
+    /** Signalled by the worker when a job has finished */
+    int event_fd = -1;
+    wl_event_source *event_source = nullptr;
+
+    bool start();
+    void enqueue(std::deque<job_t>& jobs, std::function<void()> work,
+        std::function<void()> done);
+    void run();
+    static int handle_finished(int fd, uint32_t mask, void *data);
+};
+}
+}
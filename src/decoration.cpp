@@ -4,10 +4,25 @@
 #include <wayfire/matcher.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/txn/transaction-manager.hpp>
+#include <wayfire/plugins/ipc/ipc-method-repository.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
 
 #include "deco-subsurface.hpp"
+#include "deco-shader.hpp"
+#include "deco-cache.hpp"
+#include "deco-assets.hpp"
+#include "deco-svg.hpp"
+#include "deco-worker.hpp"
+#include "deco-glyphs.hpp"
+#include "deco-textures.hpp"
+#include "deco-arena.hpp"
+#include "deco-compare.hpp"
+#include "deco-trace.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/plugin.hpp"
 #include "wayfire/signal-provider.hpp"
@@ -17,6 +32,8 @@
 #include <sys/inotify.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <algorithm>
+#include <map>
 
 class wayfire_gtkdecor : public wf::plugin_interface_t
 {
@@ -27,6 +44,15 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
     wf::option_wrapper_t<int> title_height{"gtkdecor/title_height"};
     wf::option_wrapper_t<int> border_size{"gtkdecor/border_size"};
     wf::option_wrapper_t<std::string> button_order{"gtkdecor/button_order"};
+    /* Change the shadow extent, and with it the bounding boxes */
+    wf::option_wrapper_t<int> shadow_radius{"gtkdecor/shadow_radius"};
+    wf::option_wrapper_t<int> shadow_offset{"gtkdecor/shadow_offset"};
+    wf::option_wrapper_t<wf::color_t> shadow_color{"gtkdecor/shadow_color"};
+    wf::option_wrapper_t<std::string> frame_renderer{"gtkdecor/frame_renderer"};
+    wf::option_wrapper_t<std::string> title_renderer{"gtkdecor/title_renderer"};
+    wf::option_wrapper_t<int> title_update_rate{"gtkdecor/title_update_rate"};
+
+    wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> ipc_repo;
 
     // GTK settings file monitoring
     int inotify_fd = -1;
@@ -74,6 +100,24 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
     };
 
     // allows criteria containing maximized or floating check
+    /* Buttons are pre-rendered at the scale of every output */
+    wf::signal::connection_t<wf::output_layout_configuration_changed_signal> on_outputs_changed =
+        [=] (wf::output_layout_configuration_changed_signal*)
+    {
+        update_output_scales();
+    };
+
+    void update_output_scales()
+    {
+        std::vector<double> scales;
+        for (auto output : wf::get_core().output_layout->get_outputs())
+        {
+            scales.push_back(output->handle->scale);
+        }
+
+        wf::decor::decoration_theme_t::set_output_scales(scales);
+    }
+
     wf::signal::connection_t<wf::view_tiled_signal> on_view_tiled =
         [=] (wf::view_tiled_signal *ev)
     {
@@ -171,6 +215,7 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
 
     void reload_all_decorations()
     {
+        DECO_TRACE_SPAN("reload_all_decorations");
         for (auto& view : wf::get_core().get_all_views())
         {
             if (auto toplevel = wf::toplevel_cast(view))
@@ -182,8 +227,188 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
                 }
             }
         }
+
+        /* The shadow may have shrunk, leaving pixels outside of the new
+         * bounding boxes which view->damage() does not reach */
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            output->render->damage_whole();
+        }
     }
 
+    /** Global and per-view rendering statistics, for attributing slow frames */
+    wf::ipc::method_callback on_stats = [=] (wf::json_t)
+    {
+        auto response = wf::ipc::json_ok();
+        response["global"] = wf::decor::decoration_stats_t::global().to_json();
+
+        wf::json_t views = wf::json_t::array();
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            if (auto toplevel = wf::toplevel_cast(view))
+            {
+                if (auto deco = toplevel->toplevel()->get_data<wf::simple_decorator_t>())
+                {
+                    wf::json_t entry;
+                    entry["view-id"] = (int64_t)view->get_id();
+                    entry["title"]   = view->get_title();
+                    entry["stats"]   = deco->get_stats().to_json();
+                    views.append(entry);
+                }
+            }
+        }
+
+        response["views"] = views;
+        return response;
+    };
+
+    /**
+     * Bytes held by the decoration caches, in total, per view and per
+     * category, and the largest entries, for finding what makes memory grow.
+     */
+    wf::ipc::method_callback on_memory = [=] (wf::json_t data)
+    {
+        size_t count = 10;
+        if (data.has_member("count") && data["count"].is_int() && (data["count"].as_int() >= 0))
+        {
+            count = data["count"].as_int();
+        }
+
+        auto& budget = wf::decor::texture_budget_t::get();
+        auto response = wf::ipc::json_ok();
+        response["total"]     = (int64_t)budget.get_usage();
+        response["budget"]    = (int64_t)budget.get_budget();
+        response["entries"]   = (int64_t)budget.get_entry_count();
+        response["evictions"] = (int64_t)budget.get_eviction_count();
+
+        wf::json_t categories;
+        for (int i = 0; i < wf::decor::CACHE_CATEGORY_COUNT; i++)
+        {
+            auto category = wf::decor::cache_category_t(i);
+            categories[wf::decor::texture_budget_t::get_category_name(category)] =
+                (int64_t)budget.get_usage(category);
+        }
+
+        response["categories"] = categories;
+
+        /* Entries are charged to a per-decoration token, which the
+         * decorators map back to their views */
+        struct owner_view_t
+        {
+            uint64_t view_id;
+            std::string title;
+        };
+
+        std::map<uint64_t, owner_view_t> owner_views;
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            if (auto toplevel = wf::toplevel_cast(view))
+            {
+                if (auto deco = toplevel->toplevel()->get_data<wf::simple_decorator_t>())
+                {
+                    owner_views[deco->get_owner_token()] = {
+                        view->get_id(), view->get_title()
+                    };
+                }
+            }
+        }
+
+        /* Largest first. Owner 0 holds everything shared between views. */
+        auto owners = budget.get_owners();
+        for (const auto& [owner, view] : owner_views)
+        {
+            if (!budget.get_owner_usage(owner) && !budget.get_owner_held(owner))
+            {
+                owners.push_back(owner);
+            }
+        }
+
+        std::sort(owners.begin(), owners.end(), [&] (uint64_t a, uint64_t b)
+        {
+            return budget.get_owner_usage(a) > budget.get_owner_usage(b);
+        });
+
+        wf::json_t views = wf::json_t::array();
+        for (uint64_t owner : owners)
+        {
+            wf::json_t entry;
+            wf::json_t owner_categories;
+            for (int i = 0; i < wf::decor::CACHE_CATEGORY_COUNT; i++)
+            {
+                auto category = wf::decor::cache_category_t(i);
+                if (size_t bytes = budget.get_owner_usage(owner, category))
+                {
+                    owner_categories[wf::decor::texture_budget_t::get_category_name(category)] =
+                        (int64_t)bytes;
+                }
+            }
+
+            entry["bytes"]      = (int64_t)budget.get_owner_usage(owner);
+            entry["categories"] = owner_categories;
+            if (owner == 0)
+            {
+                response["shared"] = entry;
+                continue;
+            }
+
+            auto it = owner_views.find(owner);
+            entry["owner"] = (int64_t)owner;
+            if (it != owner_views.end())
+            {
+                entry["view-id"] = (int64_t)it->second.view_id;
+                entry["title"]   = it->second.title;
+            }
+
+            /* Shared titles and pixmaps kept alive through this decoration */
+            entry["held"] = (int64_t)budget.get_owner_held(owner);
+
+            /* Charged to a decoration which no longer exists: a leak */
+            entry["orphaned"] = (it == owner_views.end());
+            views.append(entry);
+        }
+
+        response["views"] = views;
+
+        wf::json_t largest = wf::json_t::array();
+        for (auto cache_entry : budget.get_largest_entries(count))
+        {
+            wf::json_t entry;
+            auto it = owner_views.find(cache_entry->get_owner());
+            entry["owner"]   = (int64_t)cache_entry->get_owner();
+            entry["view-id"] = (int64_t)((it != owner_views.end()) ? it->second.view_id : 0);
+            entry["category"] =
+                wf::decor::texture_budget_t::get_category_name(cache_entry->get_category());
+            entry["bytes"] = (int64_t)cache_entry->get_size();
+            largest.append(entry);
+        }
+
+        response["largest"] = largest;
+        return response;
+    };
+
+    /** Check the GPU renderers against the cairo ones, see deco-compare.hpp */
+    wf::ipc::method_callback on_compare_renderers = [=] (wf::json_t data)
+    {
+        return wf::decor::compare_renderers(data);
+    };
+
+    wf::ipc::method_callback on_reset_stats = [=] (wf::json_t)
+    {
+        wf::decor::decoration_stats_t::global().reset();
+        for (auto& view : wf::get_core().get_all_views())
+        {
+            if (auto toplevel = wf::toplevel_cast(view))
+            {
+                if (auto deco = toplevel->toplevel()->get_data<wf::simple_decorator_t>())
+                {
+                    deco->get_stats().reset();
+                }
+            }
+        }
+
+        return wf::ipc::json_ok();
+    };
+
     // Callback for config option changes
     wf::config::option_base_t::updated_callback_t on_config_changed = [=] ()
     {
@@ -198,11 +423,24 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
         wf::get_core().connect(&on_decoration_state_changed);
         wf::get_core().tx_manager->connect(&on_new_tx);
         wf::get_core().connect(&on_view_tiled);
+        wf::get_core().output_layout->connect(&on_outputs_changed);
+        update_output_scales();
 
         // Setup config change callbacks for live reload
         title_height.set_callback(on_config_changed);
         border_size.set_callback(on_config_changed);
         button_order.set_callback(on_config_changed);
+        shadow_radius.set_callback(on_config_changed);
+        shadow_offset.set_callback(on_config_changed);
+        shadow_color.set_callback(on_config_changed);
+        frame_renderer.set_callback(on_config_changed);
+        title_renderer.set_callback(on_config_changed);
+        title_update_rate.set_callback(on_config_changed);
+
+        ipc_repo->register_method("gtkdecor/stats", on_stats);
+        ipc_repo->register_method("gtkdecor/reset-stats", on_reset_stats);
+        ipc_repo->register_method("gtkdecor/memory", on_memory);
+        ipc_repo->register_method("gtkdecor/compare-renderers", on_compare_renderers);
 
         for (auto& view : wf::get_core().get_all_views())
         {
@@ -215,6 +453,10 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
     void fini() override
     {
         cleanup_gtk_settings_monitor();
+        ipc_repo->unregister_method("gtkdecor/stats");
+        ipc_repo->unregister_method("gtkdecor/reset-stats");
+        ipc_repo->unregister_method("gtkdecor/memory");
+        ipc_repo->unregister_method("gtkdecor/compare-renderers");
 
         for (auto view : wf::get_core().get_all_views())
         {
@@ -224,6 +466,18 @@ class wayfire_gtkdecor : public wf::plugin_interface_t
                 wf::get_core().tx_manager->schedule_object(toplevel->toplevel());
             }
         }
+
+        wf::decor::render_worker_t::get().stop();
+        /* The textures must go while the renderer is still around */
+        wf::decor::title_cache_t::get().clear();
+        wf::decor::asset_cache_t::get().clear();
+#ifdef HAVE_LIBRSVG
+        wf::decor::svg_document_cache_t::get().clear();
+#endif
+        wf::decor::texture_pool_t::get().clear();
+        wf::decor::glyph_atlas_t::get().fini();
+        wf::decor::decoration_shaders_t::get().fini();
+        wf::decor::surface_arena_t::get().clear();
     }
 
     /**
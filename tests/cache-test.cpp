@@ -0,0 +1,161 @@
+/*
+ * Texture budget and title cache: what is charged, and what may be evicted.
+ * No texture is uploaded, only the accounting is tested.
+ */
+#include "headless.hpp"
+#include "deco-arena.hpp"
+#include "deco-cache.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace wf::decor;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static constexpr size_t TITLE_BYTES = 1024 * 1024;
+
+/** Stands in for an uploaded title, it is never dereferenced */
+static std::shared_ptr<wf::owned_texture_t> fake_texture()
+{
+    static char storage;
+    return std::shared_ptr<wf::owned_texture_t>(
+        reinterpret_cast<wf::owned_texture_t*>(&storage), [] (wf::owned_texture_t*) {});
+}
+
+static std::shared_ptr<wf::owned_texture_t> insert_title(const std::string& key)
+{
+    return title_cache_t::get().insert(key, fake_texture(), TITLE_BYTES);
+}
+
+/** Titles shown by a decoration stay charged after the cache drops them */
+static void test_held_title_stays_charged()
+{
+    auto& budget = texture_budget_t::get();
+    auto shown   = insert_title("shown");
+    insert_title("hidden");
+    CHECK(budget.get_usage(CACHE_TITLE) == 2 * TITLE_BYTES);
+
+    title_cache_t::get().clear();
+    CHECK(title_cache_t::get().size() == 0);
+    CHECK(budget.get_usage(CACHE_TITLE) == TITLE_BYTES);
+
+    shown.reset();
+    CHECK(budget.get_usage(CACHE_TITLE) == 0);
+}
+
+/** Over budget, titles nobody shows go first and shown ones stay */
+static void test_held_title_not_evicted()
+{
+    auto& budget = texture_budget_t::get();
+    auto shown   = insert_title("shown");
+    insert_title("hidden");
+    /* The frame ends, then the budget is lowered below both titles */
+    headless::run_idle();
+    headless::set_option("texture_budget", "1");
+    headless::run_idle();
+
+    CHECK(title_cache_t::get().find("hidden") == nullptr);
+    CHECK(title_cache_t::get().find("shown") != nullptr);
+    CHECK(budget.get_usage(CACHE_TITLE) == TITLE_BYTES);
+
+    headless::set_option("texture_budget", "256");
+    shown.reset();
+    title_cache_t::get().clear();
+}
+
+/** More windows than MAX_TITLES: shown titles are never dropped for space */
+static void test_cap_keeps_shown_titles()
+{
+    std::vector<std::shared_ptr<wf::owned_texture_t>> shown;
+    for (int i = 0; i < 100; i++)
+    {
+        shown.push_back(insert_title("window " + std::to_string(i)));
+    }
+
+    CHECK(title_cache_t::get().size() == 100);
+    for (int i = 0; i < 100; i++)
+    {
+        CHECK(title_cache_t::get().find("window " + std::to_string(i)) != nullptr);
+    }
+
+    shown.clear();
+    insert_title("one more");
+    CHECK(title_cache_t::get().size() <= 64);
+    title_cache_t::get().clear();
+    CHECK(texture_budget_t::get().get_usage(CACHE_TITLE) == 0);
+}
+
+/** Surfaces returned while rendering are only charged after the frame */
+static void test_arena_charged_after_frame()
+{
+    auto& budget = texture_budget_t::get();
+    auto& arena  = surface_arena_t::get();
+    arena.clear();
+
+    std::vector<cairo_surface_t*> surfaces;
+    for (int i = 0; i < 6; i++)
+    {
+        surfaces.push_back(arena.create(CAIRO_FORMAT_ARGB32, 256, 256));
+    }
+
+    for (auto surface : surfaces)
+    {
+        cairo_surface_destroy(surface);
+    }
+
+    CHECK(budget.get_usage(CACHE_SURFACE_ARENA) == 0);
+    headless::run_idle();
+    /* Trimmed to four idle 256 KiB buffers */
+    CHECK(budget.get_usage(CACHE_SURFACE_ARENA) == 4 * 256 * 1024);
+
+    arena.clear();
+    CHECK(budget.get_usage(CACHE_SURFACE_ARENA) == 0);
+}
+
+/** The leak check of a destroyed decoration trips on whatever it left behind */
+static void test_leak_check()
+{
+    auto& budget = texture_budget_t::get();
+    const uint64_t owner = 1000;
+    CHECK(budget.check_owner_released(owner));
+
+    /* A title handed out to the decoration, and a copy which escaped it */
+    auto shown = title_cache_t::get().insert("leaked", fake_texture(), TITLE_BYTES, owner);
+    auto escaped = shown;
+    CHECK(budget.get_owner_held(owner) == TITLE_BYTES);
+    shown.reset();
+    CHECK(!budget.check_owner_released(owner));
+    escaped.reset();
+    /* Still cached, but the cache's own reference is not the decoration's */
+    CHECK(title_cache_t::get().find("leaked") != nullptr);
+    CHECK(budget.check_owner_released(owner));
+
+    /* An entry of the decoration's own which was never released */
+    cache_entry_t entry(CACHE_BACKGROUND, [] {});
+    entry.set_owner(owner);
+    entry.charge(TITLE_BYTES);
+    CHECK(!budget.check_owner_released(owner));
+    entry.release();
+    CHECK(budget.check_owner_released(owner));
+    title_cache_t::get().clear();
+}
+
+int main()
+{
+    headless::init();
+    test_held_title_stays_charged();
+    test_held_title_not_evicted();
+    test_cap_keeps_shown_titles();
+    test_arena_charged_after_frame();
+    test_leak_check();
+    return failures ? 1 : 0;
+}
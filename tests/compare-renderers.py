@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# Run gtkdecor/compare-renderers in a headless Wayfire against the synthetic
+# themes in tests/themes and tests/icons, and fail if any case differs from
+# the cairo renderer by more than the tolerance. Skipped (exit code 77) where
+# Wayfire is not installed.
+#
+#   compare-renderers.py <wayfire> <plugin dir> <source dir> [dump dir]
+
+import json
+import os
+import shutil
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+THEMES = ["Adwaita-like", "WhiteSur-like", "Nordic-like", "Plain"]
+ICON_THEME = "Plain-icons"
+SKIP = 77
+
+
+def make_home(home, source_dir):
+    """A scratch HOME using the test themes, like tests/headless.cpp"""
+    os.makedirs(os.path.join(home, ".config", "gtk-3.0"))
+    os.symlink(os.path.join(source_dir, "tests", "themes"), os.path.join(home, ".themes"))
+    os.symlink(os.path.join(source_dir, "tests", "icons"), os.path.join(home, ".icons"))
+    with open(os.path.join(home, ".config", "gtk-3.0", "settings.ini"), "w") as settings:
+        settings.write("[Settings]\ngtk-theme-name=Plain\n")
+        settings.write("gtk-icon-theme-name=%s\n" % ICON_THEME)
+
+    config = os.path.join(home, "wayfire.ini")
+    with open(config, "w") as ini:
+        ini.write("[core]\nplugins = ipc gtkdecor\nxwayland = false\n")
+
+    return config
+
+
+def connect(path, wayfire, timeout=30.0):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if wayfire.poll() is not None:
+            raise RuntimeError("wayfire exited with %d" % wayfire.returncode)
+
+        try:
+            client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            client.connect(path)
+            return client
+        except OSError:
+            client.close()
+            time.sleep(0.1)
+
+    raise RuntimeError("no IPC socket at " + path)
+
+
+def receive(client, size):
+    data = b""
+    while len(data) < size:
+        chunk = client.recv(size - len(data))
+        if not chunk:
+            raise RuntimeError("wayfire closed the IPC socket")
+
+        data += chunk
+
+    return data
+
+
+def call(client, method, data):
+    """One IPC request: a native 32-bit length, then the JSON message"""
+    message = json.dumps({"method": method, "data": data}).encode()
+    client.sendall(struct.pack("=I", len(message)) + message)
+    length = struct.unpack("=I", receive(client, 4))[0]
+    return json.loads(receive(client, length))
+
+
+def main():
+    if len(sys.argv) < 4:
+        print("usage: compare-renderers.py <wayfire> <plugin dir> <source dir> [dump dir]",
+              file=sys.stderr)
+        return 2
+
+    wayfire_path, plugin_dir, source_dir = sys.argv[1:4]
+    dump_dir = sys.argv[4] if len(sys.argv) > 4 else ""
+    if not wayfire_path or not shutil.which(wayfire_path):
+        print("wayfire not found, skipping", file=sys.stderr)
+        return SKIP
+
+    home = tempfile.mkdtemp(prefix="gtkdecor-compare-")
+    try:
+        config = make_home(home, source_dir)
+        ipc_path = os.path.join(home, "wayfire.socket")
+        env = dict(os.environ)
+        env.update({
+            "HOME": home,
+            "XDG_RUNTIME_DIR": home,
+            "WLR_BACKENDS": "headless",
+            "WLR_HEADLESS_OUTPUTS": "1",
+            "WLR_RENDERER": "gles2",
+            "WLR_LIBINPUT_NO_DEVICES": "1",
+            "WAYFIRE_PLUGIN_PATH": plugin_dir,
+            "WAYFIRE_PLUGIN_XML_PATH": os.path.join(source_dir, "metadata"),
+            "_WAYFIRE_SOCKET": ipc_path,
+        })
+
+        with open(os.path.join(home, "wayfire.log"), "w") as log:
+            wayfire = subprocess.Popen([wayfire_path, "-c", config], env=env,
+                                       stdout=log, stderr=subprocess.STDOUT)
+            try:
+                client = connect(ipc_path, wayfire)
+                request = {"themes": THEMES, "icon-theme": ICON_THEME}
+                if dump_dir:
+                    request["dump-dir"] = dump_dir
+
+                response = call(client, "gtkdecor/compare-renderers", request)
+                client.close()
+            finally:
+                wayfire.terminate()
+                try:
+                    wayfire.wait(timeout=10)
+                except subprocess.TimeoutExpired:
+                    wayfire.kill()
+
+        if response.get("result") != "ok":
+            print("compare-renderers failed: %s" % response.get("error", response),
+                  file=sys.stderr)
+            with open(os.path.join(home, "wayfire.log")) as log:
+                sys.stderr.write(log.read())
+            return 1
+
+        for case in response["cases"]:
+            print(json.dumps(case))
+
+        print("%d of %d cases differ" % (response["failed"], len(response["cases"])))
+        return 1 if response["failed"] > 0 else 0
+    except RuntimeError as error:
+        print(error, file=sys.stderr)
+        log_path = os.path.join(home, "wayfire.log")
+        if os.path.exists(log_path):
+            with open(log_path) as log:
+                sys.stderr.write(log.read())
+        return 1
+    finally:
+        shutil.rmtree(home, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
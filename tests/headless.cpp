@@ -0,0 +1,489 @@
+#include "headless.hpp"
+#include "deco-shader.hpp"
+#include "deco-worker.hpp"
+#include <wayfire/config/file.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#ifndef GTKDECOR_SOURCE_DIR
+#error "GTKDECOR_SOURCE_DIR must point at the source tree"
+#endif
+
+namespace fs = std::filesystem;
+
+static std::unique_ptr<wf::config::config_manager_t> config;
+static fs::path scratch_home;
+/** Callbacks given to wl_idle_call::set_callback() */
+static std::map<wf::wl_idle_call*, std::function<void()>> idle_handlers;
+/** Callbacks scheduled with wl_idle_call::run_once() */
+static std::map<wf::wl_idle_call*, std::function<void()>> idle_callbacks;
+
+/* What the compositor provides to plugins, reduced to what the theme uses */
+
+std::shared_ptr<wf::config::option_base_t> wf::detail::load_raw_option(const std::string& name)
+{
+    return config ? config->get_option(name) : nullptr;
+}
+
+wf::wl_idle_call::wl_idle_call()
+{}
+
+wf::wl_idle_call::~wl_idle_call()
+{
+    disconnect();
+    idle_handlers.erase(this);
+}
+
+void wf::wl_idle_call::set_callback(callback_t call)
+{
+    disconnect();
+    idle_handlers[this] = std::move(call);
+}
+
+void wf::wl_idle_call::run_once()
+{
+    auto it = idle_handlers.find(this);
+    if (it != idle_handlers.end())
+    {
+        idle_callbacks[this] = it->second;
+    }
+}
+
+void wf::wl_idle_call::run_once(callback_t call)
+{
+    idle_callbacks[this] = std::move(call);
+}
+
+void wf::wl_idle_call::disconnect()
+{
+    idle_callbacks.erase(this);
+}
+
+bool wf::wl_idle_call::is_connected() const
+{
+    return idle_callbacks.count(const_cast<wl_idle_call*>(this));
+}
+
+void wf::wl_idle_call::execute()
+{
+    auto it = idle_callbacks.find(this);
+    if (it != idle_callbacks.end())
+    {
+        auto call = std::move(it->second);
+        idle_callbacks.erase(it);
+        call();
+    }
+}
+
+/*
+ * Everything else the theme calls in the compositor, GL and wlroots only runs
+ * while drawing, which no test does. The tests link without unresolved
+ * symbols, so each one is stubbed here and aborts with its name if reached.
+ */
+
+[[noreturn]] static void unreachable(const char *name)
+{
+    std::cerr << "headless: " << name << " needs the compositor" << std::endl;
+    std::abort();
+}
+
+wf::compositor_core_t& wf::get_core()
+{
+    unreachable("wf::get_core()");
+}
+
+wf::owned_texture_t::owned_texture_t(cairo_surface_t*)
+{
+    unreachable("wf::owned_texture_t");
+}
+
+wf::owned_texture_t::~owned_texture_t()
+{
+    unreachable("wf::owned_texture_t");
+}
+
+wlr_texture *wf::owned_texture_t::get_texture() const
+{
+    unreachable("wf::owned_texture_t::get_texture()");
+}
+
+wf::dimensions_t wf::owned_texture_t::get_size() const
+{
+    unreachable("wf::owned_texture_t::get_size()");
+}
+
+void wf::scene::render_pass_t::add_texture(const wf::texture_t&, const wf::render_target_t&,
+    const wf::geometry_t&, const wf::region_t&, float)
+{
+    unreachable("wf::scene::render_pass_t::add_texture()");
+}
+
+bool wf::scene::render_pass_t::custom_gles_subpass(const wf::render_target_t&,
+    std::function<void()>)
+{
+    unreachable("wf::scene::render_pass_t::custom_gles_subpass()");
+}
+
+/* There is no GL context: clean-ups skip their GL part, as on other renderers */
+bool wf::gles::run_in_context_if_gles(std::function<void()>)
+{
+    return false;
+}
+
+void wf::gles::bind_render_buffer(const wf::render_target_t&)
+{
+    unreachable("wf::gles::bind_render_buffer()");
+}
+
+glm::mat4 wf::gles::render_target_orthographic_projection(const wf::render_target_t&)
+{
+    unreachable("wf::gles::render_target_orthographic_projection()");
+}
+
+void wf::gles::render_target_logic_scissor(const wf::render_target_t&, wlr_box)
+{
+    unreachable("wf::gles::render_target_logic_scissor()");
+}
+
+GLuint OpenGL::compile_program(std::string, std::string)
+{
+    unreachable("OpenGL::compile_program()");
+}
+
+/* The glyph atlas and the shaders hold programs, which are never compiled */
+class OpenGL::program_t::impl
+{};
+
+OpenGL::program_t::program_t()
+{}
+
+OpenGL::program_t::~program_t()
+{}
+
+void OpenGL::program_t::set_simple(GLuint, wf::texture_type_t)
+{
+    unreachable("OpenGL::program_t::set_simple()");
+}
+
+void OpenGL::program_t::use(wf::texture_type_t)
+{
+    unreachable("OpenGL::program_t::use()");
+}
+
+void OpenGL::program_t::attrib_pointer(const std::string&, int, int, const void*, GLenum)
+{
+    unreachable("OpenGL::program_t::attrib_pointer()");
+}
+
+void OpenGL::program_t::uniform1i(const std::string&, int)
+{
+    unreachable("OpenGL::program_t::uniform1i()");
+}
+
+void OpenGL::program_t::uniformMatrix4f(const std::string&, const glm::mat4&)
+{
+    unreachable("OpenGL::program_t::uniformMatrix4f()");
+}
+
+void OpenGL::program_t::deactivate()
+{
+    unreachable("OpenGL::program_t::deactivate()");
+}
+
+void OpenGL::program_t::free_resources()
+{
+    unreachable("OpenGL::program_t::free_resources()");
+}
+
+void gl_call(const char*, uint32_t, const char*)
+{
+    unreachable("gl_call()");
+}
+
+extern "C" {
+bool wlr_texture_is_gles2(wlr_texture*)
+{
+    unreachable("wlr_texture_is_gles2()");
+}
+
+void wlr_gles2_texture_get_attribs(wlr_texture*, wlr_gles2_texture_attribs*)
+{
+    unreachable("wlr_gles2_texture_get_attribs()");
+}
+
+bool wlr_gles2_renderer_check_ext(wlr_renderer*, const char*)
+{
+    unreachable("wlr_gles2_renderer_check_ext()");
+}
+
+void glActiveTexture(GLenum)
+{
+    unreachable("glActiveTexture()");
+}
+
+void glBindTexture(GLenum, GLuint)
+{
+    unreachable("glBindTexture()");
+}
+
+void glBlendFunc(GLenum, GLenum)
+{
+    unreachable("glBlendFunc()");
+}
+
+void glDeleteTextures(GLsizei, const GLuint*)
+{
+    unreachable("glDeleteTextures()");
+}
+
+void glDrawArrays(GLenum, GLint, GLsizei)
+{
+    unreachable("glDrawArrays()");
+}
+
+void glEnable(GLenum)
+{
+    unreachable("glEnable()");
+}
+
+void glGenTextures(GLsizei, GLuint*)
+{
+    unreachable("glGenTextures()");
+}
+
+void glPixelStorei(GLenum, GLint)
+{
+    unreachable("glPixelStorei()");
+}
+
+void glTexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*)
+{
+    unreachable("glTexImage2D()");
+}
+
+void glTexParameteri(GLenum, GLenum, GLint)
+{
+    unreachable("glTexParameteri()");
+}
+
+void glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*)
+{
+    unreachable("glTexSubImage2D()");
+}
+}
+
+namespace wf
+{
+namespace decor
+{
+render_worker_t& render_worker_t::get()
+{
+    static render_worker_t worker;
+    return worker;
+}
+
+void render_worker_t::submit(std::function<void()> work, std::function<void()> done)
+{
+    work();
+    done();
+}
+
+void render_worker_t::submit_background(std::function<void()> work, std::function<void()> done)
+{
+    work();
+    done();
+}
+
+void render_worker_t::stop()
+{}
+
+decoration_shaders_t& decoration_shaders_t::get()
+{
+    unreachable("decoration_shaders_t::get()");
+}
+
+bool decoration_shaders_t::is_supported()
+{
+    return false;
+}
+
+int decoration_shaders_t::get_shadow_extent(double radius, wf::pointf_t offset)
+{
+    return static_cast<int>(std::ceil(3.0 * std::max(radius, 0.0) +
+        std::max(std::abs(offset.x), std::abs(offset.y))));
+}
+
+void decoration_shaders_t::render_shadow(const wf::scene::render_instruction_t&,
+    const shadow_params_t&)
+{
+    unreachable("decoration_shaders_t::render_shadow()");
+}
+
+void decoration_shaders_t::render_frame(const wf::scene::render_instruction_t&,
+    const frame_params_t&)
+{
+    unreachable("decoration_shaders_t::render_frame()");
+}
+
+namespace headless
+{
+static void remove_scratch_home()
+{
+    std::error_code error;
+    fs::remove_all(scratch_home, error);
+}
+
+void init()
+{
+    wf::log::initialize_logging(std::cerr, wf::log::LOG_LEVEL_ERROR,
+        wf::log::LOG_COLOR_MODE_OFF);
+
+    char home_template[] = "/tmp/gtkdecor-test-XXXXXX";
+    if (!mkdtemp(home_template))
+    {
+        std::perror("mkdtemp");
+        std::exit(1);
+    }
+
+    scratch_home = home_template;
+    std::atexit(remove_scratch_home);
+    const fs::path source_dir = GTKDECOR_SOURCE_DIR;
+    fs::create_directories(scratch_home / ".config" / "gtk-3.0");
+    fs::create_directory_symlink(source_dir / "tests" / "themes", scratch_home / ".themes");
+    fs::create_directory_symlink(source_dir / "tests" / "icons", scratch_home / ".icons");
+    setenv("HOME", scratch_home.c_str(), 1);
+
+    /* No user configuration, every option has its default */
+    const fs::path wayfire_ini = scratch_home / "wayfire.ini";
+    std::ofstream{wayfire_ini};
+    config = std::make_unique<wf::config::config_manager_t>(
+        wf::config::build_configuration({(source_dir / "metadata").string()}, "",
+            wayfire_ini.string()));
+
+    use_theme("Plain", "Plain-icons");
+}
+
+void set_option(const std::string& name, const std::string& value)
+{
+    auto option = config->get_option("gtkdecor/" + name);
+    if (!option || !option->set_value_str(value))
+    {
+        std::cerr << "Cannot set gtkdecor/" << name << " to " << value << std::endl;
+        std::exit(1);
+    }
+}
+
+void use_theme(const std::string& gtk_theme, const std::string& icon_theme,
+    const std::string& font)
+{
+    std::ofstream settings{scratch_home / ".config" / "gtk-3.0" / "settings.ini"};
+    settings << "[Settings]\n";
+    settings << "gtk-theme-name=" << gtk_theme << "\n";
+    settings << "gtk-icon-theme-name=" << icon_theme << "\n";
+    if (!font.empty())
+    {
+        settings << "gtk-font-name=" << font << "\n";
+    }
+}
+
+void run_idle()
+{
+    while (!idle_callbacks.empty())
+    {
+        idle_callbacks.begin()->first->execute();
+    }
+}
+
+timing_t measure(const std::string& name, size_t iterations,
+    const std::function<void()>& body)
+{
+    static constexpr size_t WARM_UP_RUNS = 3;
+    for (size_t i = 0; i < WARM_UP_RUNS; i++)
+    {
+        body();
+        run_idle();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        samples.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+        /* Every run is a frame, whatever is deferred to its end is not timed */
+        run_idle();
+    }
+
+    timing_t timing;
+    timing.name = name;
+    timing.iterations = iterations;
+    if (!samples.empty())
+    {
+        std::sort(samples.begin(), samples.end());
+        timing.min_us    = samples.front();
+        timing.median_us = samples[samples.size() / 2];
+        timing.p95_us    = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+    }
+
+    return timing;
+}
+
+std::string json_string(const std::string& text)
+{
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            out << '\\' << c;
+        } else if (c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else
+        {
+            out << c;
+        }
+    }
+
+    out << '"';
+    return out.str();
+}
+
+void print_timing(const timing_t& timing, const std::string& extra)
+{
+    std::cout << "{\"name\": " << json_string(timing.name) <<
+        ", \"iterations\": " << timing.iterations <<
+        ", \"min_us\": " << timing.min_us <<
+        ", \"median_us\": " << timing.median_us <<
+        ", \"p95_us\": " << timing.p95_us;
+    if (!extra.empty())
+    {
+        std::cout << ", " << extra;
+    }
+
+    std::cout << "}" << std::endl;
+}
+}
+}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "deco-theme.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace wf
+{
+namespace decor
+{
+/** Calls the private loaders and finders of decoration_theme_t */
+struct theme_probe_t
+{
+    static void load(const decoration_theme_t& theme)
+    {
+        theme.load_gtk_theme();
+    }
+
+    static std::string find_theme_css_file(const decoration_theme_t& theme,
+        const std::string& theme_name)
+    {
+        return theme.find_theme_css_file(theme_name);
+    }
+
+    static std::string find_icon_file(const decoration_theme_t& theme,
+        const std::string& icon_name, int size)
+    {
+        return theme.find_icon_file(icon_name, size);
+    }
+
+    static std::string find_titlebutton_file(const decoration_theme_t& theme,
+        button_type_t button, const decoration_theme_t::button_state_t& state)
+    {
+        return theme.find_titlebutton_file(button, state);
+    }
+
+    static void parse_theme_css(const decoration_theme_t& theme, const std::string& css_file)
+    {
+        theme.parse_theme_css(css_file);
+    }
+
+    static void paint_cairo_shadow(const decoration_theme_t& theme, cairo_t *cr,
+        decoration_theme_t::frame_part_t part, const wf::geometry_t& rect,
+        double width, double height)
+    {
+        theme.paint_cairo_shadow(cr, part, rect, width, height);
+    }
+};
+
+/**
+ * Runs the theme and its caches without a compositor, for the tests and
+ * benchmarks. The options come from metadata/gtkdecor.xml, and $HOME is a
+ * scratch directory whose .themes and .icons are the test themes.
+ *
+ * Nothing may reach the GL renderer: shaders report themselves unsupported,
+ * the render worker runs jobs right away, and idle callbacks only run from
+ * run_idle(). Every other compositor, GL and wlroots function the theme
+ * calls is stubbed to abort with its name.
+ */
+namespace headless
+{
+/** Set up options, $HOME and logging. Call before creating any theme. */
+void init();
+
+/** Set a gtkdecor option, e.g. set_option("title_height", "28") */
+void set_option(const std::string& name, const std::string& value);
+
+/** Select the GTK theme, icon theme and font in the scratch settings.ini */
+void use_theme(const std::string& gtk_theme, const std::string& icon_theme,
+    const std::string& font = "");
+
+/** Run the pending idle callbacks, as the event loop does after a frame */
+void run_idle();
+
+/** Timings of one benchmark case, in microseconds */
+struct timing_t
+{
+    std::string name;
+    size_t iterations = 0;
+    double min_us    = 0;
+    double median_us = 0;
+    double p95_us    = 0;
+};
+
+/**
+ * Time @iterations runs of @body, after a few which are not counted.
+ * The idle callbacks run between runs, outside of the timings.
+ */
+timing_t measure(const std::string& name, size_t iterations,
+    const std::function<void()>& body);
+
+/** @return @text as a quoted JSON string */
+std::string json_string(const std::string& text);
+
+/**
+ * Print a timing as one line of JSON on stdout.
+ * @param extra Further members, e.g. "\"bytes\": 42", or empty
+ */
+void print_timing(const timing_t& timing, const std::string& extra = "");
+}
+}
+}
@@ -0,0 +1,132 @@
+/*
+ * Count and time the stat() calls made while finding theme files, for the
+ * synthetic themes in tests/themes and tests/icons, each laid out like a
+ * family of real themes. Linked with -Wl,--wrap=stat, so every stat() of
+ * the theme code is counted, not just those it counts itself.
+ *
+ *   lookup-bench [iterations]
+ */
+#include "headless.hpp"
+#include "deco-cache.hpp"
+#include "deco-theme.hpp"
+#include <sys/stat.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace wf::decor;
+using wf::decor::headless::measure;
+using wf::decor::headless::print_timing;
+
+static size_t stat_calls = 0;
+
+extern "C" int __real_stat(const char *path, struct stat *buffer);
+
+extern "C" int __wrap_stat(const char *path, struct stat *buffer)
+{
+    stat_calls++;
+    return __real_stat(path, buffer);
+}
+
+struct theme_case_t
+{
+    std::string gtk_theme;
+    std::string icon_theme;
+};
+
+static const std::vector<theme_case_t> cases = {
+    /* Colours among a long stylesheet, icons in symbolic/ui */
+    {"Adwaita-like", "Adwaita"},
+    /* metacity-1/titlebuttons/titlebutton-<action>[-state].svg */
+    {"WhiteSur-like", "Plain-icons"},
+    /* Only gtk-dark.css, metacity-1/<action>_<focus>_<state>.png; icons
+     * spread over an Inherits= chain which the finder does not follow */
+    {"Nordic-like", "Chain-child"},
+};
+
+/**
+ * Time @lookup with the lookup cache emptied before every run, then with it
+ * warm, and print both with the stat() calls of one run.
+ */
+static void bench_lookup(const std::string& name, size_t iterations,
+    const std::function<void()>& lookup)
+{
+    auto& cache = path_lookup_cache_t::get();
+    cache.clear();
+    stat_calls = 0;
+    lookup();
+    const size_t cold_stats = stat_calls;
+    print_timing(measure(name + "/cold", iterations, [&]
+    {
+        cache.clear();
+        lookup();
+    }), "\"stat_calls\": " + std::to_string(cold_stats));
+
+    stat_calls = 0;
+    lookup();
+    const size_t warm_stats = stat_calls;
+    print_timing(measure(name + "/warm", iterations, lookup),
+        "\"stat_calls\": " + std::to_string(warm_stats));
+}
+
+int main(int argc, char **argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+    headless::init();
+
+    for (const auto& theme_case : cases)
+    {
+        headless::use_theme(theme_case.gtk_theme, theme_case.icon_theme);
+        decoration_theme_t theme;
+        theme.set_buttons(button_type_t(BUTTON_CLOSE | BUTTON_TOGGLE_MAXIMIZE | BUTTON_MINIMIZE));
+        theme.reload_theme();
+        theme_probe_t::load(theme);
+
+        const std::string prefix = theme_case.gtk_theme + "+" + theme_case.icon_theme;
+        const int size = static_cast<int>(theme.get_button_size());
+
+        bench_lookup(prefix + "/find_theme_css_file", iterations, [&]
+        {
+            theme_probe_t::find_theme_css_file(theme, theme_case.gtk_theme);
+        });
+
+        bench_lookup(prefix + "/find_icon_file", iterations, [&]
+        {
+            for (auto icon : {"window-close-symbolic", "window-maximize-symbolic",
+                "window-minimize-symbolic"})
+            {
+                theme_probe_t::find_icon_file(theme, icon, size);
+            }
+        });
+
+        /* Every state a button is drawn in */
+        bench_lookup(prefix + "/find_titlebutton_file", iterations, [&]
+        {
+            for (auto button : {BUTTON_CLOSE, BUTTON_TOGGLE_MAXIMIZE, BUTTON_MINIMIZE})
+            {
+                for (bool activated : {true, false})
+                {
+                    for (double hover : {0.0, 0.5, 1.0, -0.7})
+                    {
+                        const decoration_theme_t::button_state_t state = {
+                            .width  = (double)size,
+                            .height = (double)size,
+                            .border = 2.0,
+                            .hover_progress = hover,
+                            .activated = activated,
+                        };
+                        theme_probe_t::find_titlebutton_file(theme, button, state);
+                    }
+                }
+            }
+        });
+
+        const std::string css = theme_probe_t::find_theme_css_file(theme, theme_case.gtk_theme);
+        print_timing(measure(prefix + "/parse_theme_css", iterations, [&]
+        {
+            theme_probe_t::parse_theme_css(theme, css);
+        }), "\"file\": " + headless::json_string(css.substr(css.find("/.themes/") + 1)));
+    }
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Time the CPU side of drawing a decoration: loading the theme, rasterizing
+ * the frame parts, titles and buttons, on cairo image surfaces and without
+ * a compositor. Prints one JSON object per case on stdout.
+ *
+ *   render-bench [iterations]
+ */
+#include "headless.hpp"
+#include "deco-theme.hpp"
+#include <cairo.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace wf::decor;
+using wf::decor::headless::measure;
+using wf::decor::headless::print_timing;
+
+static std::string size_name(int width, int height)
+{
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+static const char *get_button_name(button_type_t button)
+{
+    switch (button)
+    {
+      case BUTTON_CLOSE:
+        return "close";
+
+      case BUTTON_TOGGLE_MAXIMIZE:
+        return "maximize";
+
+      case BUTTON_MINIMIZE:
+        return "minimize";
+
+      default:
+        return "unknown";
+    }
+}
+
+static const char *get_part_name(decoration_theme_t::frame_part_t part)
+{
+    switch (part)
+    {
+      case decoration_theme_t::FRAME_PART_TITLEBAR:
+        return "titlebar";
+
+      case decoration_theme_t::FRAME_PART_LEFT:
+        return "left";
+
+      case decoration_theme_t::FRAME_PART_RIGHT:
+        return "right";
+
+      case decoration_theme_t::FRAME_PART_BOTTOM:
+        return "bottom";
+
+      default:
+        return "unknown";
+    }
+}
+
+static void bench_theme_load(size_t iterations)
+{
+    decoration_theme_t theme;
+    theme.set_buttons(button_type_t(BUTTON_CLOSE | BUTTON_TOGGLE_MAXIMIZE | BUTTON_MINIMIZE));
+    /* Includes the lookups, the CSS and rasterizing the button images */
+    print_timing(measure("theme-load", iterations, [&]
+    {
+        theme.reload_theme();
+        theme_probe_t::load(theme);
+    }));
+
+    const std::string css = theme_probe_t::find_theme_css_file(theme, "Plain");
+    print_timing(measure("parse-css/Plain", iterations, [&]
+    {
+        theme_probe_t::parse_theme_css(theme, css);
+    }));
+}
+
+static void bench_frame(size_t iterations)
+{
+    static const std::vector<wf::dimensions_t> sizes = {{800, 600}, {1920, 1080}, {3840, 2160}};
+    static const decoration_theme_t::frame_part_t parts[] = {
+        decoration_theme_t::FRAME_PART_TITLEBAR, decoration_theme_t::FRAME_PART_LEFT,
+        decoration_theme_t::FRAME_PART_RIGHT, decoration_theme_t::FRAME_PART_BOTTOM,
+    };
+
+    decoration_theme_t theme;
+    theme_probe_t::load(theme);
+    for (auto size : sizes)
+    {
+        for (auto part : parts)
+        {
+            size_t bytes = 0;
+            auto timing = measure(std::string("frame-part/") + get_part_name(part) + "/" +
+                size_name(size.width, size.height), iterations, [&]
+            {
+                wf::geometry_t rect;
+                auto surface = theme.rasterize_frame_part(part, size.width, size.height,
+                    true, true, rect);
+                bytes = static_cast<size_t>(cairo_image_surface_get_stride(surface)) *
+                    cairo_image_surface_get_height(surface);
+                cairo_surface_destroy(surface);
+            });
+            print_timing(timing, "\"bytes\": " + std::to_string(bytes));
+        }
+
+        /* All parts, as after a resize or focus change */
+        print_timing(measure("frame/" + size_name(size.width, size.height), iterations, [&]
+        {
+            for (auto part : parts)
+            {
+                wf::geometry_t rect;
+                cairo_surface_destroy(theme.rasterize_frame_part(part, size.width, size.height,
+                    false, true, rect));
+            }
+        }));
+    }
+}
+
+static void bench_titles(size_t iterations)
+{
+    static const std::vector<std::string> titles = {
+        "Terminal",
+        "README.md — ~/src/gtkdecor — Text Editor",
+        "Ελληνικά · Русский · 日本語 · 한국어",
+    };
+
+    decoration_theme_t theme;
+    theme_probe_t::load(theme);
+    const int height = theme.get_title_height();
+    for (size_t i = 0; i < titles.size(); i++)
+    {
+        for (int width : {400, 1200})
+        {
+            print_timing(measure("title/" + std::to_string(i) + "/" +
+                size_name(width, height), iterations, [&]
+            {
+                cairo_surface_destroy(theme.render_text(titles[i], width, height));
+            }), "\"text\": " + headless::json_string(titles[i]));
+        }
+    }
+}
+
+static void bench_buttons(size_t iterations)
+{
+    decoration_theme_t theme;
+    theme.set_buttons(button_type_t(BUTTON_CLOSE | BUTTON_TOGGLE_MAXIMIZE | BUTTON_MINIMIZE));
+    theme_probe_t::load(theme);
+    const double size = theme.get_button_size();
+    for (auto button : {BUTTON_CLOSE, BUTTON_TOGGLE_MAXIMIZE, BUTTON_MINIMIZE})
+    {
+        for (double hover : {0.0, 1.0, -1.0})
+        {
+            const decoration_theme_t::button_state_t state = {
+                .width  = size,
+                .height = size,
+                .border = 2.0,
+                .hover_progress = hover,
+                .activated = true,
+            };
+            print_timing(measure(std::string("button/") + get_button_name(button) + "/hover=" +
+                std::to_string(hover), iterations, [&]
+            {
+                cairo_surface_destroy(theme.get_button_surface(button, state));
+            }));
+        }
+    }
+
+    /* A hover fading in draws the button at every step of the animation */
+    print_timing(measure("button-hover-animation", iterations, [&]
+    {
+        static constexpr int STEPS = 10;
+        for (int step = 0; step <= STEPS; step++)
+        {
+            const decoration_theme_t::button_state_t state = {
+                .width  = size,
+                .height = size,
+                .border = 2.0,
+                .hover_progress = double(step) / STEPS,
+                .activated = true,
+            };
+            cairo_surface_destroy(theme.get_button_surface(BUTTON_CLOSE, state));
+        }
+    }));
+}
+
+int main(int argc, char **argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 50;
+    headless::init();
+    bench_theme_load(iterations);
+    bench_frame(iterations);
+    bench_titles(iterations);
+    bench_buttons(iterations);
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * Time the CPU drop shadow of the frame parts: the blurred shadow drawn now
+ * against the stack of widening translucent strokes it replaced, which is
+ * kept here as it was. Prints one JSON object per case on stdout.
+ *
+ *   shadow-bench [iterations]
+ */
+#include "headless.hpp"
+#include "deco-simd.hpp"
+#include "deco-theme.hpp"
+#include <cairo.h>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace wf::decor;
+using wf::decor::headless::measure;
+using wf::decor::headless::print_timing;
+
+/* The frame's fixed bottom corner radius */
+static constexpr int BOTTOM_CORNER_RADIUS = 8;
+
+static const char *get_part_name(decoration_theme_t::frame_part_t part)
+{
+    switch (part)
+    {
+      case decoration_theme_t::FRAME_PART_TITLEBAR:
+        return "titlebar";
+
+      case decoration_theme_t::FRAME_PART_LEFT:
+        return "left";
+
+      case decoration_theme_t::FRAME_PART_RIGHT:
+        return "right";
+
+      case decoration_theme_t::FRAME_PART_BOTTOM:
+        return "bottom";
+
+      default:
+        return "unknown";
+    }
+}
+
+/**
+ * The shadow as the frame parts stroked it before it was blurred: @passes
+ * lines per part, each wider and more opaque than the last. @margin is where
+ * the decoration starts in the part's surface.
+ */
+static void stroke_shadow(cairo_t *cr, const decoration_theme_t& theme,
+    decoration_theme_t::frame_part_t part, double width, int margin, int passes,
+    int shadow_offset)
+{
+    const double radius = theme.get_corner_radius();
+    const double border = theme.get_border_size();
+    for (int i = passes; i > 0; i--)
+    {
+        const double alpha = 0.1 * (1.0 - (double)i / passes);
+        cairo_set_source_rgba(cr, 0, 0, 0, alpha);
+        cairo_set_line_width(cr, i * 2.0);
+        switch (part)
+        {
+          case decoration_theme_t::FRAME_PART_TITLEBAR:
+          {
+            const double h = theme.get_title_height() + border;
+            const double x = margin + 0.5;
+            const double y = margin + shadow_offset + 0.5;
+            cairo_new_sub_path(cr);
+            cairo_arc(cr, x + radius, y + radius, radius, M_PI, 3 * M_PI / 2);
+            cairo_line_to(cr, x + width - radius, y);
+            cairo_arc(cr, x + width - radius, y + radius, radius, -M_PI / 2, 0);
+            cairo_line_to(cr, x + width, y + h);
+            cairo_line_to(cr, x, y + h);
+            cairo_close_path(cr);
+            break;
+          }
+
+          case decoration_theme_t::FRAME_PART_LEFT:
+          case decoration_theme_t::FRAME_PART_RIGHT:
+          {
+            const double x = (part == decoration_theme_t::FRAME_PART_LEFT) ?
+                margin + 0.5 : border - 0.5;
+            cairo_move_to(cr, x, 0);
+            cairo_line_to(cr, x, cairo_image_surface_get_height(cairo_get_target(cr)));
+            break;
+          }
+
+          case decoration_theme_t::FRAME_PART_BOTTOM:
+          {
+            const double br = BOTTOM_CORNER_RADIUS;
+            const double h  = border + br;
+            const double x  = margin;
+            const double y  = shadow_offset;
+            cairo_new_sub_path(cr);
+            cairo_move_to(cr, x, y + 0.5);
+            cairo_line_to(cr, x + width, y + 0.5);
+            cairo_line_to(cr, x + width, y + h - br + 0.5);
+            cairo_arc(cr, x + width - br, y + h - br + 0.5, br, 0, M_PI / 2);
+            cairo_line_to(cr, x + br, y + h + 0.5);
+            cairo_arc(cr, x + br, y + h - br + 0.5, br, M_PI / 2, M_PI);
+            cairo_close_path(cr);
+            break;
+          }
+
+          default:
+            break;
+        }
+
+        cairo_stroke(cr);
+    }
+}
+
+/** Time @draw on a cleared surface of the part's size */
+static headless::timing_t measure_part(const std::string& name, size_t iterations,
+    const wf::geometry_t& rect, const std::function<void(cairo_t*)>& draw)
+{
+    return measure(name, iterations, [&]
+    {
+        auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, rect.width, rect.height);
+        auto cr = cairo_create(surface);
+        draw(cr);
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+    });
+}
+
+static void bench_shadow(size_t iterations, int shadow_radius)
+{
+    static const std::vector<wf::dimensions_t> sizes = {{800, 600}, {1920, 1080}, {3840, 2160}};
+    static const decoration_theme_t::frame_part_t parts[] = {
+        decoration_theme_t::FRAME_PART_TITLEBAR, decoration_theme_t::FRAME_PART_LEFT,
+        decoration_theme_t::FRAME_PART_RIGHT, decoration_theme_t::FRAME_PART_BOTTOM,
+    };
+
+    const int shadow_offset = 2;
+    headless::set_option("shadow_radius", std::to_string(shadow_radius));
+    headless::set_option("shadow_offset", std::to_string(shadow_offset));
+    decoration_theme_t theme;
+    theme_probe_t::load(theme);
+
+    const int margin = theme.get_shadow_extent();
+    /* As many strokes as it takes to reach as far as the blur */
+    const int passes = margin - shadow_offset;
+    const std::string radius_name = "/r=" + std::to_string(shadow_radius);
+
+    for (auto size : sizes)
+    {
+        const std::string size_name = std::to_string(size.width) + "x" +
+            std::to_string(size.height);
+        for (auto part : parts)
+        {
+            const auto rect = theme.get_frame_part_rect(part, size.width, size.height);
+            const std::string suffix = std::string("/") + get_part_name(part) + "/" +
+                size_name + radius_name;
+            print_timing(measure_part("shadow/stroke" + suffix, iterations, rect,
+                [&] (cairo_t *cr)
+            {
+                stroke_shadow(cr, theme, part, size.width, margin, passes, shadow_offset);
+            }), "\"passes\": " + std::to_string(passes));
+
+            print_timing(measure_part("shadow/blur" + suffix, iterations, rect,
+                [&] (cairo_t *cr)
+            {
+                theme_probe_t::paint_cairo_shadow(theme, cr, part, rect, size.width,
+                    size.height);
+            }), "\"simd\": " + headless::json_string(get_simd_name()));
+        }
+    }
+
+    /* The blur itself, once for all windows whenever the radius changes */
+    const int box_radius = passes / 3;
+    const int template_width  = 2 * theme.get_corner_radius() + 12 * box_radius + 1;
+    const int template_height = theme.get_corner_radius() + BOTTOM_CORNER_RADIUS +
+        12 * box_radius + 1;
+    auto mask = cairo_image_surface_create(CAIRO_FORMAT_A8, template_width, template_height);
+    print_timing(measure("shadow/template" + radius_name, iterations, [&]
+    {
+        blur_alpha_mask(cairo_image_surface_get_data(mask), template_width, template_height,
+            cairo_image_surface_get_stride(mask), box_radius);
+    }), "\"simd\": " + headless::json_string(get_simd_name()));
+    cairo_surface_destroy(mask);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 50;
+    headless::init();
+    for (int shadow_radius : {3, 6, 12})
+    {
+        bench_shadow(iterations, shadow_radius);
+    }
+
+    return 0;
+}
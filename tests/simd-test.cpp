@@ -0,0 +1,209 @@
+/*
+ * The SIMD kernels on every instruction set this build and CPU can run:
+ * the blur against a naive box blur, painting through a mask against the
+ * scalar kernel.
+ */
+#include "deco-simd.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace wf::decor;
+
+static int failures = 0;
+
+/** Random test images, the same on every run */
+static std::mt19937 random_engine(42);
+
+static std::vector<uint8_t> random_bytes(size_t count)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> bytes(count);
+    for (auto& value : bytes)
+    {
+        value = byte(random_engine);
+    }
+
+    return bytes;
+}
+
+/**
+ * One box pass of @radius over a packed image, summing every pixel of the
+ * window and scaling the sum as the kernels do.
+ */
+static void naive_box_pass(std::vector<int>& image, int width, int height, int radius,
+    bool horizontal)
+{
+    const uint32_t factor = (65536 + radius) / (2 * radius + 1);
+    std::vector<int> result(image.size());
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t sum = 0;
+            for (int k = -radius; k <= radius; k++)
+            {
+                const int sx = horizontal ? x + k : x;
+                const int sy = horizontal ? y : y + k;
+                if ((sx >= 0) && (sx < width) && (sy >= 0) && (sy < height))
+                {
+                    sum += image[size_t(sy) * width + sx];
+                }
+            }
+
+            result[size_t(y) * width + x] = (sum * factor) >> 16;
+        }
+    }
+
+    image.swap(result);
+}
+
+static void check_blur(const std::string& simd, int width, int height, int stride, int radius)
+{
+    auto pixels = random_bytes(size_t(stride) * height);
+    std::vector<int> expected(size_t(width) * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            expected[size_t(y) * width + x] = pixels[size_t(y) * stride + x];
+        }
+    }
+
+    const auto padding = pixels;
+    blur_alpha_mask(pixels.data(), width, height, stride, radius);
+
+    const int clamped = std::min(radius, MAX_BLUR_RADIUS);
+    if (clamped > 0)
+    {
+        for (int pass = 0; pass < 3; pass++)
+        {
+            naive_box_pass(expected, width, height, clamped, false);
+        }
+
+        for (int pass = 0; pass < 3; pass++)
+        {
+            naive_box_pass(expected, width, height, clamped, true);
+        }
+    }
+
+    int wrong = 0;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < stride; x++)
+        {
+            const size_t i = size_t(y) * stride + x;
+            const int value = (x < width) ? expected[size_t(y) * width + x] : padding[i];
+            wrong += (pixels[i] != value);
+        }
+    }
+
+    if (wrong > 0)
+    {
+        std::fprintf(stderr, "%s: blur of %dx%d (stride %d) with radius %d: "
+                             "%d pixels differ from the naive blur\n",
+            simd.c_str(), width, height, stride, radius, wrong);
+        failures++;
+    }
+}
+
+static void test_blur(const std::string& simd)
+{
+    /* Widths around the 8 and 16 pixel vectors, strides with padding */
+    check_blur(simd, 1, 1, 4, 1);
+    check_blur(simd, 7, 5, 8, 2);
+    check_blur(simd, 16, 16, 16, 3);
+    check_blur(simd, 53, 37, 64, 4);
+    check_blur(simd, 33, 90, 36, 6);
+    check_blur(simd, 120, 17, 120, 20);
+    /* Radii larger than the image, and larger than MAX_BLUR_RADIUS */
+    check_blur(simd, 12, 9, 12, 30);
+    check_blur(simd, 300, 260, 300, MAX_BLUR_RADIUS);
+    check_blur(simd, 40, 40, 40, 1000);
+    /* No blur at all */
+    check_blur(simd, 20, 20, 20, 0);
+}
+
+/** paint_alpha_mask() on a copy of @pixels, with the kernels of @simd */
+static std::vector<uint8_t> paint(const std::string& simd, std::vector<uint8_t> pixels,
+    int stride, const std::vector<uint8_t>& mask, int mask_stride, int width, int height,
+    uint32_t color)
+{
+    use_simd(simd);
+    paint_alpha_mask(pixels.data(), stride, mask.data(), mask_stride, width, height, color);
+    return pixels;
+}
+
+static void check_paint(const std::string& simd, int width, int height, uint32_t color)
+{
+    const int stride = width * 4 + 12;
+    const int mask_stride = width + 5;
+    const auto pixels = random_bytes(size_t(stride) * height);
+    auto mask = random_bytes(size_t(mask_stride) * height);
+    /* Runs of fully transparent and fully opaque coverage, as in icons */
+    for (size_t i = 0; i < mask.size(); i++)
+    {
+        if ((i / 8) % 3 == 0)
+        {
+            mask[i] = 0;
+        } else if ((i / 8) % 3 == 1)
+        {
+            mask[i] = (mask[i] < 128) ? 255 : mask[i];
+        }
+    }
+
+    const auto expected = paint("scalar", pixels, stride, mask, mask_stride, width, height,
+        color);
+    const auto result = paint(simd, pixels, stride, mask, mask_stride, width, height, color);
+
+    int wrong = 0;
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        wrong += (result[i] != expected[i]);
+    }
+
+    if (wrong > 0)
+    {
+        std::fprintf(stderr, "%s: painting 0x%08x through a %dx%d mask: "
+                             "%d bytes differ from the scalar kernel\n",
+            simd.c_str(), color, width, height, wrong);
+        failures++;
+    }
+}
+
+static void test_paint(const std::string& simd)
+{
+    /* Premultiplied colors: opaque, translucent, transparent and white */
+    for (uint32_t color : {0xff202428u, 0x80101820u, 0x00000000u, 0xffffffffu, 0x40404040u})
+    {
+        /* Widths around the 4 and 8 pixel vectors */
+        for (int width : {1, 3, 4, 7, 8, 9, 16, 37})
+        {
+            check_paint(simd, width, 5, color);
+        }
+
+        check_paint(simd, 64, 64, color);
+    }
+}
+
+int main()
+{
+    for (const auto& simd : get_supported_simd_names())
+    {
+        if (!use_simd(simd))
+        {
+            std::fprintf(stderr, "%s is listed but cannot be selected\n", simd.c_str());
+            failures++;
+            continue;
+        }
+
+        test_blur(simd);
+        test_paint(simd);
+        std::printf("%s: checked\n", simd.c_str());
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * The theme file finders against the synthetic themes in tests/themes and
+ * tests/icons, with and without the lookup cache.
+ */
+#include "headless.hpp"
+#include "deco-cache.hpp"
+#include "deco-theme.hpp"
+#include <cstdio>
+#include <string>
+
+using namespace wf::decor;
+
+static int failures = 0;
+
+#define CHECK_SUFFIX(path, suffix) \
+    do { \
+        const std::string value = (path); \
+        const std::string expected = (suffix); \
+        if ((value.size() < expected.size()) || \
+            (value.compare(value.size() - expected.size(), expected.size(), expected) != 0)) { \
+            std::fprintf(stderr, "%s:%d: %s is \"%s\", expected to end in \"%s\"\n", \
+                __FILE__, __LINE__, #path, value.c_str(), expected.c_str()); \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EMPTY(path) \
+    do { \
+        const std::string value = (path); \
+        if (!value.empty()) { \
+            std::fprintf(stderr, "%s:%d: %s is \"%s\", expected nothing\n", \
+                __FILE__, __LINE__, #path, value.c_str()); \
+            failures++; \
+        } \
+    } while (0)
+
+static decoration_theme_t::button_state_t get_state(double hover, bool activated)
+{
+    return decoration_theme_t::button_state_t{
+        .width  = 36,
+        .height = 36,
+        .border = 2.0,
+        .hover_progress = hover,
+        .activated = activated,
+    };
+}
+
+/** Both lookups of every case: uncached, then answered by the cache */
+template<class Lookup>
+static void check_twice(const Lookup& lookup)
+{
+    path_lookup_cache_t::get().clear();
+    lookup();
+    lookup();
+}
+
+static void test_css()
+{
+    headless::use_theme("Nordic-like", "Plain-icons");
+    decoration_theme_t theme;
+    theme.reload_theme();
+    check_twice([&]
+    {
+        CHECK_SUFFIX(theme_probe_t::find_theme_css_file(theme, "Adwaita-like"),
+            "/Adwaita-like/gtk-3.0/gtk.css");
+        /* Only ships the dark variant */
+        CHECK_SUFFIX(theme_probe_t::find_theme_css_file(theme, "Nordic-like"),
+            "/Nordic-like/gtk-3.0/gtk-dark.css");
+        CHECK_EMPTY(theme_probe_t::find_theme_css_file(theme, "Missing"));
+    });
+}
+
+static void test_titlebuttons_modern()
+{
+    headless::use_theme("WhiteSur-like", "Plain-icons");
+    decoration_theme_t theme;
+    theme.reload_theme();
+    theme_probe_t::load(theme);
+    const std::string dir = "/WhiteSur-like/metacity-1/titlebuttons/";
+    check_twice([&]
+    {
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(0.0, true)), dir + "titlebutton-close.svg");
+        /* Any hover progress shows the hover asset, halfway through too */
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(0.5, true)), dir + "titlebutton-close-hover.svg");
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(1.0, true)), dir + "titlebutton-close-hover.svg");
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_MINIMIZE,
+            get_state(-0.7, true)), dir + "titlebutton-minimize-active.svg");
+        /* No backdrop hover asset: falls back to the plain backdrop one */
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_TOGGLE_MAXIMIZE,
+            get_state(1.0, false)), dir + "titlebutton-maximize-backdrop.svg");
+    });
+}
+
+static void test_titlebuttons_classic()
+{
+    headless::use_theme("Nordic-like", "Plain-icons");
+    decoration_theme_t theme;
+    theme.reload_theme();
+    theme_probe_t::load(theme);
+    const std::string dir = "/Nordic-like/metacity-1/";
+    check_twice([&]
+    {
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(0.0, true)), dir + "close_focused_normal.png");
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(1.0, true)), dir + "close_focused_prelight.png");
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_CLOSE,
+            get_state(-0.7, true)), dir + "close_focused_pressed.png");
+        CHECK_SUFFIX(theme_probe_t::find_titlebutton_file(theme, BUTTON_MINIMIZE,
+            get_state(-0.7, false)), dir + "minimize_unfocused.png");
+    });
+}
+
+static void test_icons()
+{
+    headless::use_theme("Plain", "Chain-child");
+    decoration_theme_t theme;
+    theme.reload_theme();
+    theme_probe_t::load(theme);
+    check_twice([&]
+    {
+        CHECK_SUFFIX(theme_probe_t::find_icon_file(theme, "window-close-symbolic", 36),
+            "/Chain-child/actions/symbolic/window-close-symbolic.svg");
+        /* Inherits= is not followed, Adwaita is the only fallback */
+        CHECK_SUFFIX(theme_probe_t::find_icon_file(theme, "window-maximize-symbolic", 36),
+            "/Adwaita/symbolic/ui/window-maximize-symbolic.svg");
+        CHECK_EMPTY(theme_probe_t::find_icon_file(theme, "window-missing-symbolic", 36));
+    });
+}
+
+int main()
+{
+    headless::init();
+    test_css();
+    test_titlebuttons_modern();
+    test_titlebuttons_classic();
+    test_icons();
+    return failures ? 1 : 0;
+}